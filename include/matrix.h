@@ -1,45 +1,146 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+// Element type, fixed when a matrix is created from the element_size passed in:
+// sizeof(double) gives MATRIX_F64, sizeof(float) MATRIX_F32 and sizeof(double _Complex)
+// MATRIX_C128; other sizes are refused. Functions taking several matrices need them
+// all to share one type.
+typedef enum {
+  MATRIX_F64,
+  MATRIX_F32,
+  MATRIX_C128         // complex double, stored as interleaved (re, im) pairs
+} matrix_dtype;
+
 typedef struct matrix_s {
-  unsigned int num_rows;
-  unsigned int num_cols;
-  void *data;
+  size_t num_rows;
+  size_t num_cols;
+  size_t stride;          // elements between the starts of consecutive rows, >= num_cols
+  void *data;             // element (i, j) is data[i * stride + j]; 64-byte aligned unless a view
+  matrix_dtype dtype;     // what data holds; zero-initialized matrices are MATRIX_F64
+  bool owns_data;         // false for views, which alias another matrix's data
+  bool mapped;            // data was mapped from the kernel rather than taken from the allocator
   bool is_square;
 } matrix;
 
 typedef struct Range_s {
-  int start;
-  int end;
+  int64_t start;      // first index, or -1 for the first row/column
+  int64_t end;        // one past the last index, or -1 for the last row/column
 } Range;
 
 typedef struct {
-  matrix *L;
-  matrix *U;
-  matrix *P;
-  unsigned int num_permutations;
+  matrix *L;          // dense unit lower factor, built on demand by matrix_lup_L()
+  matrix *U;          // dense upper factor, built on demand by matrix_lup_U()
+  matrix *P;          // dense permutation, built on demand by matrix_lup_P()
+  matrix *LU;         // packed factors: L's multipliers below the diagonal, U on and above it
+  bool owns_LU;       // false when LU is the caller's matrix, factored in place
+  size_t *pivots;     // row i was swapped with row pivots[i], in order (LAPACK ipiv)
+  size_t num_permutations;
 
 } matrix_lup;
 
 typedef struct {
-  matrix *L;
-  unsigned int num_permutations;
+  matrix *L;          // lower factor, A = L * L^T; when factored in place only its lower triangle is L
+  bool owns_L;        // false when L is the caller's matrix, factored in place
 } matrix_cholesky;
 
 
+/******* Inline Element Access *******/
+// matrix_get, matrix_put and matrix_ptr index without a function call, for hot loops.
+// They are unchecked when MATRIX_CHECKED is 0, the default when NDEBUG is defined;
+// otherwise (debug builds) an out-of-range index aborts like matrix_at does.
+// matrix_get and matrix_put work on any element type, converting to and from double
+// (the real part of a complex element); matrix_get_c and matrix_put_c do the same
+// with complex values, dropping the imaginary part when storing into a real matrix.
+// matrix_ptr is for MATRIX_F64 matrices, matrix_ptr_f32 for MATRIX_F32 and
+// matrix_ptr_c128 for MATRIX_C128.
+#ifndef MATRIX_CHECKED
+#ifdef NDEBUG
+#define MATRIX_CHECKED 0
+#else
+#define MATRIX_CHECKED 1
+#endif
+#endif
+
+// Reports an invalid element access and exits; called by the checked accessors
+_Noreturn void matrix_bounds_fail(const matrix *mat, size_t i, size_t j);
+
+static inline double *matrix_ptr(const matrix *mat, size_t i, size_t j) {
+#if MATRIX_CHECKED
+  if (!mat || !mat->data || i >= mat->num_rows || j >= mat->num_cols || mat->dtype != MATRIX_F64) {
+    matrix_bounds_fail(mat, i, j);
+  }
+#endif
+  return (double *)mat->data + (size_t)i * mat->stride + j;
+}
+
+static inline float *matrix_ptr_f32(const matrix *mat, size_t i, size_t j) {
+#if MATRIX_CHECKED
+  if (!mat || !mat->data || i >= mat->num_rows || j >= mat->num_cols || mat->dtype != MATRIX_F32) {
+    matrix_bounds_fail(mat, i, j);
+  }
+#endif
+  return (float *)mat->data + (size_t)i * mat->stride + j;
+}
+
+static inline double _Complex *matrix_ptr_c128(const matrix *mat, size_t i, size_t j) {
+#if MATRIX_CHECKED
+  if (!mat || !mat->data || i >= mat->num_rows || j >= mat->num_cols || mat->dtype != MATRIX_C128) {
+    matrix_bounds_fail(mat, i, j);
+  }
+#endif
+  return (double _Complex *)mat->data + (size_t)i * mat->stride + j;
+}
+
+static inline double matrix_get(const matrix *mat, size_t i, size_t j) {
+  if (mat->dtype == MATRIX_F32) {
+    return *matrix_ptr_f32(mat, i, j);
+  }
+  if (mat->dtype == MATRIX_C128) {
+    return *(const double *)matrix_ptr_c128(mat, i, j);
+  }
+  return *matrix_ptr(mat, i, j);
+}
+
+static inline void matrix_put(matrix *mat, size_t i, size_t j, double value) {
+  if (mat->dtype == MATRIX_F32) {
+    *matrix_ptr_f32(mat, i, j) = (float)value;
+  } else if (mat->dtype == MATRIX_C128) {
+    *matrix_ptr_c128(mat, i, j) = value;
+  } else {
+    *matrix_ptr(mat, i, j) = value;
+  }
+}
+
+static inline double _Complex matrix_get_c(const matrix *mat, size_t i, size_t j) {
+  if (mat->dtype == MATRIX_C128) {
+    return *matrix_ptr_c128(mat, i, j);
+  }
+  return matrix_get(mat, i, j);
+}
+
+static inline void matrix_put_c(matrix *mat, size_t i, size_t j, double _Complex value) {
+  if (mat->dtype == MATRIX_C128) {
+    *matrix_ptr_c128(mat, i, j) = value;
+  } else {
+    matrix_put(mat, i, j, ((const double *)&value)[0]);
+  }
+}
+
 /******* Matrix Initialization Operations *******/
-matrix *matrix_new(unsigned int num_rows, unsigned int num_cols, size_t element_size);
+matrix *matrix_new(size_t num_rows, size_t num_cols, size_t element_size);
+matrix *matrix_new_padded(size_t num_rows, size_t num_cols, size_t element_size);
 
-matrix *matrix_rand(unsigned int num_rows, 
-                    unsigned int num_cols, 
+matrix *matrix_rand(size_t num_rows, 
+                    size_t num_cols, 
                     double min, 
                     double max, 
                     size_t element_size);
 
-matrix *matrix_sqr(unsigned int size, size_t element_size);
-matrix *matrix_eye(unsigned int size, size_t element_size, const void *identity_element);
+matrix *matrix_sqr(size_t size, size_t element_size);
+matrix *matrix_eye(size_t size, size_t element_size, const void *identity_element);
 
 void matrix_free(matrix *mat);
 void matrix_print(const matrix *matrix);
@@ -50,28 +151,55 @@ int matrix_eq(const matrix *m1, const matrix *m2, double tolerance);
 bool matrix_is_symmetric(matrix *mat);
 bool matrix_is_posdef(matrix *mat);
 
-matrix *matrix_col_get(const matrix *mat, unsigned int col_num);
-matrix *matrix_row_get(const matrix *mat, unsigned int row_num);
+matrix *matrix_col_get(const matrix *mat, size_t col_num);
+matrix *matrix_row_get(const matrix *mat, size_t row_num);
 
-double matrix_at(const matrix *mat, unsigned int i, unsigned int j);
+double matrix_at(const matrix *mat, size_t i, size_t j);
 matrix *matrix_slice(matrix *mat, Range row_range, Range col_range);
 matrix *matrix_submatrix(const matrix *mat, Range row_range, Range col_range);
 matrix *matrix_copy(const matrix *src);
-
-void matrix_set(matrix *mat, unsigned int i, unsigned int j, double value);
+matrix *matrix_copy_into(matrix *dst, const matrix *src);
+
+// Bytes per element of mat: sizeof(double), sizeof(float) or sizeof(double _Complex)
+size_t matrix_element_size(const matrix *mat);
+
+// Packed copy of src with elements converted to dtype (rounded when narrowing; the
+// imaginary part is dropped when converting a complex matrix to a real type)
+matrix *matrix_convert(const matrix *src, matrix_dtype dtype);
+
+/******* Views *******/
+// A view aliases a block of another matrix in O(1): no allocation, no copy, and the
+// parent's stride, so any function taking a const matrix * reads it directly, and
+// writes through it land in the parent. Views are returned by value, stay valid only
+// while the parent's data does, and must not be passed to matrix_free, matrix_transpose,
+// matrix_row_rem or matrix_col_rem. An invalid range gives a view with NULL data.
+matrix matrix_view(const matrix *mat, Range row_range, Range col_range);
+matrix matrix_row_view(const matrix *mat, size_t row);
+matrix matrix_col_view(const matrix *mat, size_t col);
+
+void matrix_set(matrix *mat, size_t i, size_t j, double value);
 void matrix_all_set(matrix *mat, const void *value, size_t value_size);
 void matrix_diag_set(matrix *mat, const void *value, size_t value_size);
 
+// In place, in the same buffer: swapping blocks when square, following the permutation's
+// cycles (one bit of scratch per element) otherwise
 void matrix_transpose(matrix *mat);
+matrix *matrix_transpose_into(matrix *dst, const matrix *mat);
+
+// Transpose that also conjugates complex elements (the plain transpose for real types)
+void matrix_conj_transpose(matrix *mat);
+matrix *matrix_conj_transpose_into(matrix *dst, const matrix *mat);
 matrix *matrix_stackv(const matrix *mat1, const matrix *mat2);
 matrix *matrix_stackh(const matrix *mat1, const matrix *mat2);
+matrix *matrix_stackv_into(matrix *dst, const matrix *mat1, const matrix *mat2);
+matrix *matrix_stackh_into(matrix *dst, const matrix *mat1, const matrix *mat2);
 
 /******* Internal Structure Change Functions *******/
-matrix *matrix_row_rem(matrix *mat, unsigned int row);
-matrix *matrix_col_rem(matrix *mat, unsigned int col);
+matrix *matrix_row_rem(matrix *mat, size_t row);
+matrix *matrix_col_rem(matrix *mat, size_t col);
 
-void matrix_swap_rows(matrix *mat, unsigned int row1, unsigned int row2);
-void matrix_swap_cols(matrix *mat, unsigned int col1, unsigned int col2);
+void matrix_swap_rows(matrix *mat, size_t row1, size_t row2);
+void matrix_swap_cols(matrix *mat, size_t col1, size_t col2);
 
 
 /******* Internal Structure Change Functions *******/
@@ -81,38 +209,223 @@ void matrix_swap_cols(matrix *mat, unsigned int col1, unsigned int col2);
 double matrix_trace(matrix *mat);
 
 //multiply a row with a scalar
-void matrix_row_mult_r(matrix *mat, unsigned int row, double value);
+void matrix_row_mult_r(matrix *mat, size_t row, double value);
 
 //multiply a column with a scalar
-void matrix_col_mult_r(matrix *mat, unsigned int col, double value);
+void matrix_col_mult_r(matrix *mat, size_t col, double value);
 
 //multiply a matrix with a scalar (all rows and columns)
 void matrix_mult_r(matrix *mat, double value);
 
-void matrix_row_addrow(matrix *mat, unsigned int row1_index, unsigned int row2_index, double factor);
+//multiply a complex matrix with a complex scalar
+void matrix_mult_c(matrix *mat, double _Complex value);
+
+void matrix_row_addrow(matrix *mat, size_t row1_index, size_t row2_index, double factor);
 
 
 matrix *matrix_add(const matrix *mat1, const matrix *mat2);
 matrix *matrix_subtract(const matrix *mat1, const matrix *mat2);
 matrix *matrix_mult(const matrix *mat1, const matrix *mat2);
 
-int matrix_pivotidx(matrix *mat, unsigned int col, unsigned int row);
+// Allocation-free forms: write into dst, which must already have the result's shape,
+// and return it (NULL on a shape mismatch). add/subtract allow dst to be an operand;
+// the others refuse a dst that overlaps an input.
+matrix *matrix_add_into(matrix *dst, const matrix *mat1, const matrix *mat2);
+matrix *matrix_subtract_into(matrix *dst, const matrix *mat1, const matrix *mat2);
+matrix *matrix_mult_into(matrix *dst, const matrix *mat1, const matrix *mat2);
+
+// dst = alpha * mat1 * mat2 + beta * dst; dst is not read when beta == 0
+matrix *matrix_gemm_into(matrix *dst, double alpha, const matrix *mat1, const matrix *mat2, double beta);
+
+// How a product reads an operand. The transposes are taken while the operand is packed
+// for the multiply, so X^T * X and the like never build a transposed copy.
+typedef enum {
+  MATRIX_OP_NONE,
+  MATRIX_OP_TRANS,
+  MATRIX_OP_CONJ_TRANS      // conjugate transpose; the plain transpose for real types
+} matrix_op;
+
+// op1(mat1) * op2(mat2), and dst = alpha * op1(mat1) * op2(mat2) + beta * dst
+matrix *matrix_mult_op(const matrix *mat1, matrix_op op1, const matrix *mat2, matrix_op op2);
+matrix *matrix_gemm_op_into(matrix *dst, double alpha, const matrix *mat1, matrix_op op1,
+                            const matrix *mat2, matrix_op op2, double beta);
+
+// Which triangle of a symmetric matrix is computed or read
+typedef enum {
+  MATRIX_LOWER,
+  MATRIX_UPPER
+} matrix_uplo;
+
+// Symmetric rank-k update (SYRK): dst = alpha * op(mat) * op(mat)^T + beta * dst, e.g. the
+// Gram matrix X^T * X with MATRIX_OP_TRANS. Only the uplo triangle of dst is computed, for
+// half the flops of matrix_gemm_op_into; with mirror it is then copied over the other
+// triangle, which is otherwise left untouched. matrix_syrk returns a new, mirrored result.
+// Real matrices only.
+matrix *matrix_syrk_into(matrix *dst, double alpha, const matrix *mat, matrix_op op, double beta,
+                         matrix_uplo uplo, bool mirror);
+matrix *matrix_syrk(const matrix *mat, matrix_op op);
+
+// Symmetric multiply (SYMM): dst = alpha * sym * mat + beta * dst, reading only the uplo
+// triangle of the square sym. Real matrices only.
+matrix *matrix_symm_into(matrix *dst, double alpha, const matrix *sym, matrix_uplo uplo,
+                         const matrix *mat, double beta);
+matrix *matrix_symm(const matrix *sym, matrix_uplo uplo, const matrix *mat);
+
+// How complex products are formed from real ones: 4M uses four real GEMMs, 3M (Gauss)
+// three, for a quarter fewer flops but a slightly larger error in the imaginary part
+typedef enum {
+  MATRIX_COMPLEX_GEMM_4M,   // the default
+  MATRIX_COMPLEX_GEMM_3M
+} matrix_complex_gemm;
+
+void matrix_set_complex_gemm(matrix_complex_gemm method);
+
+/*******   Fused element-wise expressions   *******/
+
+// Records element-wise arithmetic on real matrices and scalars without computing it.
+// matrix_expr_eval then produces the result in a single pass: each input is read
+// once and the output written once, with intermediates kept in cache-sized tiles.
+// Nodes are ints, -1 on error (which later calls pass through); a node may be used
+// any number of times. Matrices must stay alive and unchanged until evaluation.
+typedef struct matrix_expr matrix_expr;
+
+matrix_expr *matrix_expr_new(void);
+void matrix_expr_free(matrix_expr *expr);
+void matrix_expr_clear(matrix_expr *expr);  // drops all nodes, keeps the memory
+
+int matrix_expr_matrix(matrix_expr *expr, const matrix *mat);
+int matrix_expr_scalar(matrix_expr *expr, double value);
+int matrix_expr_add(matrix_expr *expr, int a, int b);
+int matrix_expr_sub(matrix_expr *expr, int a, int b);
+int matrix_expr_mul(matrix_expr *expr, int a, int b);  // element by element
+int matrix_expr_div(matrix_expr *expr, int a, int b);
+int matrix_expr_neg(matrix_expr *expr, int a);
+
+// Evaluates node root into dst, which may be one of its operands, or into a new matrix
+// when dst is NULL. All matrices must share one shape and element type (MATRIX_F64 or
+// MATRIX_F32, computed in double). Returns dst, or NULL on error. If evaluation runs out
+// of scratch memory part-way, some tiles of dst have already been written: a dst that
+// is also an operand is then left partly overwritten.
+matrix *matrix_expr_eval(const matrix_expr *expr, int root, matrix *dst);
+
+int64_t matrix_pivotidx(matrix *mat, size_t col, size_t row);
 matrix *matrix_ref(matrix *mat);
 
-matrix_lup *matrix_lup_new(matrix *L, matrix *U, matrix *P, unsigned int num_permutations);
+matrix_lup *matrix_lup_new(matrix *L, matrix *U, matrix *P, size_t num_permutations);
 matrix_lup *matrix_lup_solve(matrix *m);
 void matrix_lup_free(matrix_lup *lu);
 
+matrix_lup *matrix_lup_factor(matrix *m, bool in_place);
+matrix *matrix_lup_L(matrix_lup *lu);
+matrix *matrix_lup_U(matrix_lup *lu);
+matrix *matrix_lup_P(matrix_lup *lu);
+void matrix_lup_permute(const matrix_lup *lu, matrix *b);
+
 matrix *matrix_ls_solvefwd(matrix *L, matrix *b);
 matrix *matrix_ls_solvebck(matrix *U, matrix *b);
 matrix *matrix_ls_solve(matrix_lup *lu, matrix *b);
 
 matrix *matrix_inv(matrix *mat);
+matrix *matrix_inv_into(matrix *dst, const matrix *mat);
+matrix *matrix_lup_inv(const matrix_lup *lu, matrix *dst);
 
 double matrix_det(matrix_lup *lup);
+double _Complex matrix_det_c(matrix_lup *lup);  // also for complex factorizations
 
 matrix_lup *matrix_cholesky_solve(matrix *mat);
 void matrix_cholesky_free(matrix_lup *cholesky);
 
+matrix_cholesky *matrix_cholesky_factor(matrix *m, bool in_place);
+void matrix_cholesky_factor_free(matrix_cholesky *chol);
+matrix *matrix_cholesky_ls_solve(const matrix_cholesky *chol, matrix *b);
+matrix *matrix_cholesky_inv(const matrix_cholesky *chol, matrix *dst);
+double matrix_cholesky_logdet(const matrix_cholesky *chol);
+
+/*******   Memory allocation   *******/
+
+// Allocator for everything the library puts on the heap: matrix headers and data,
+// factorization results and workspace arenas. aligned_alloc is only asked for powers
+// of two and sizes that are multiples of them. Install one before allocating: memory
+// is always released through the allocator installed at the time it is freed
+// (arenas keep the one they were created with).
+typedef struct {
+  void *(*alloc)(void *ctx, size_t size);
+  void *(*aligned_alloc)(void *ctx, size_t alignment, size_t size);
+  void (*free)(void *ctx, void *ptr);
+  void *ctx;          // passed back to every call
+} matrix_allocator;
+
+// Returns false, leaving the allocator unchanged, if a function is missing; NULL restores libc.
+bool matrix_set_allocator(const matrix_allocator *allocator);
+matrix_allocator matrix_get_allocator(void);
+
+// Largest matrix data buffer, in bytes, that matrix_new and friends will allocate;
+// larger requests return NULL. 0 restores the default: MATRIX_MAX_ALLOCATION if set
+// (a byte count, optionally suffixed K, M, G or T), otherwise 1 GB. SIZE_MAX lifts the cap.
+void matrix_set_max_allocation(size_t bytes);
+size_t matrix_get_max_allocation(void);
+
+// While the libc allocator is installed, matrix data of at least the threshold (default
+// 4 MiB; 0 restores it, SIZE_MAX turns mapping off) is mmap'ed: pages are zeroed lazily
+// by the kernel instead of memset, and huge pages are used as configured.
+typedef enum {
+  MATRIX_HUGE_PAGES_NONE,         // ordinary pages
+  MATRIX_HUGE_PAGES_TRANSPARENT,  // madvise(MADV_HUGEPAGE), the default
+  MATRIX_HUGE_PAGES_EXPLICIT      // MAP_HUGETLB from the hugetlbfs pool, else transparent
+} matrix_huge_pages;
+
+void matrix_set_mmap_threshold(size_t bytes);
+void matrix_set_huge_pages(matrix_huge_pages mode);
+
+/*******   Workspace arenas   *******/
+
+// Temporaries inside the library (GEMM packing panels, pivots, panel buffers) come
+// from a per-thread arena: a stack of reusable blocks reset in O(1). Each thread has
+// a default arena that keeps its peak size until the thread exits, so repeated calls
+// of the same size stop allocating after the first. Requests over 4 MiB are the
+// exception: they are taken from the heap under the matrix_set_max_allocation cap
+// (mapped like matrix data) and returned when released. matrix_arena_use makes the
+// calling thread draw from the caller's arena instead (NULL goes back to the default)
+// and returns the previous one. Worker threads always use their own default arenas.
+typedef struct matrix_arena matrix_arena;
+
+matrix_arena *matrix_arena_new(size_t capacity);  // initial bytes, grows on demand; 0 = default
+void matrix_arena_free(matrix_arena *arena);
+matrix_arena *matrix_arena_use(matrix_arena *arena);
+
+// 64-byte aligned bytes that live until the next matrix_arena_reset; NULL if out of memory
+void *matrix_arena_alloc(matrix_arena *arena, size_t bytes);
+
+// Releases everything allocated from the arena but keeps its blocks; must not be
+// called while a library call is using the arena
+void matrix_arena_reset(matrix_arena *arena);
+size_t matrix_arena_capacity(const matrix_arena *arena);
+
+/*******   Threading   *******/
+
+// Number of threads the library's kernels may use, including the calling thread.
+// 0 restores the default: MATRIX_NUM_THREADS if set, otherwise the online CPU count.
+void matrix_set_num_threads(unsigned int num_threads);
+unsigned int matrix_get_num_threads(void);
+
+/*******   CPU dispatch   *******/
+
+// The hot kernels (GEMM micro-kernels, element-wise arithmetic, transposes and the LU
+// panel update) are built for several instruction sets, and the best one the CPU
+// supports is picked once when the library loads. MATRIX_ISA=scalar, sse4.2, avx2 or
+// avx512 lowers that choice, to test or compare the variants.
+typedef enum {
+    MATRIX_ISA_SCALAR,
+    MATRIX_ISA_SSE42,
+    MATRIX_ISA_AVX2,    // with FMA
+    MATRIX_ISA_AVX512,  // AVX-512F
+} matrix_isa;
+
+// Switches to the best variants at or below isa that the CPU supports and returns the
+// level now in use. Must not be called while another thread is inside the library.
+matrix_isa matrix_set_isa(matrix_isa isa);
+matrix_isa matrix_get_isa(void);
+const char *matrix_isa_name(matrix_isa isa);
+
 #endif //MATRIX_H
 
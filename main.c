@@ -223,7 +223,7 @@ int main() {
     matrix_print(lup->U);
 
     printf("Matrix P is:\n");
-    matrix_print(lup->P);
+    matrix_print(matrix_lup_P(lup));
 
     matrix_lup_free(lup);
     matrix_free(mat9);
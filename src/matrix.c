@@ -1,8 +1,10 @@
 #include "matrix.h"
+#include "matrix_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <complex.h>
 #include <stdint.h>
 
 double matrix_rand_interval(double min, double max) {
@@ -10,15 +12,215 @@ double matrix_rand_interval(double min, double max) {
     return min + d * (max - min);
 }
 
-matrix *matrix_new(unsigned int num_rows, unsigned int num_cols, size_t element_size) {
+// Rows and data buffers start on cache-line (and AVX-512 vector) boundaries
+#define MATRIX_ALIGN 64
+
+static inline size_t dtype_size(matrix_dtype dtype) {
+    switch (dtype) {
+        case MATRIX_F32: return sizeof(float);
+        case MATRIX_C128: return sizeof(double complex);
+        default: return sizeof(double);
+    }
+}
+
+size_t matrix_element_size(const matrix *mat) {
+    return dtype_size(mat->dtype);
+}
+
+// Start of row i, honouring the matrix's stride; row_ptr for MATRIX_F64 matrices,
+// row_ptr_f32 for MATRIX_F32 ones and row_bytes for code that only moves elements
+static inline double *row_ptr(const matrix *mat, size_t i) {
+    return (double *)mat->data + (size_t)i * mat->stride;
+}
+
+
+static inline float *row_ptr_f32(const matrix *mat, size_t i) {
+    return (float *)mat->data + (size_t)i * mat->stride;
+}
+
+static inline char *row_bytes(const matrix *mat, size_t i) {
+    return (char *)mat->data + (size_t)i * mat->stride * dtype_size(mat->dtype);
+}
+
+// Row i as doubles, for element-wise work that treats a complex row as 2 * num_cols
+// reals; row_width gives the count. MATRIX_F64 and MATRIX_C128 only.
+static inline double *row_reals(const matrix *mat, size_t i) {
+    return (double *)row_bytes(mat, i);
+}
+
+static inline size_t row_width(const matrix *mat) {
+    return (mat->dtype == MATRIX_C128) ? 2 * mat->num_cols : mat->num_cols;
+}
+
+// Functions taking several matrices never convert between element types
+static bool same_dtype(const matrix *a, const matrix *b) {
+    if (a->dtype != b->dtype) {
+        fprintf(stderr, "Matrices have different element types.\n");
+        return false;
+    }
+    return true;
+}
+
+/******* Element-wise engine *******/
+
+// add, subtract, mult_r and all_set see their operands as rows of reals (a complex
+// element is two doubles). When every operand is packed, stride == num_cols, the
+// whole buffer is one long row, so the SIMD kernels run over it in a single call.
+// Work above EW_PARALLEL_MIN reals is cut into a few tasks per thread, because one
+// core cannot saturate memory bandwidth on its own.
+
+#define EW_PARALLEL_MIN ((size_t)1 << 18)  // 2 MiB of doubles
+
+// Smallest task, and the granularity of a split row: whole cache lines for both types
+#define EW_TASK_MIN ((size_t)1 << 14)
+#define EW_TASK_ALIGN 16
+
+#define EW_TASKS_PER_THREAD 4
+
+// Outputs at least this large, that are not also an input, are written with
+// streaming stores: they would not stay in cache anyway
+#define EW_STREAM_MIN ((size_t)8 << 20)
+
+typedef enum { EW_ADD, EW_SCALE, EW_FILL } ew_op;
+
+typedef struct {
+    ew_op op;
+    bool f32;                  // float elements, else doubles
+    size_t rows, width;        // rows and reals per row
+    char *z;                   // output, and the operand of EW_SCALE
+    const char *x, *y;         // EW_ADD operands
+    size_t ldz, ldx, ldy;      // row pitch in bytes
+    double s;                  // EW_ADD sign or EW_SCALE factor
+    double fill[2];            // EW_FILL value; complex values alternate fill[0], fill[1]
+    bool fill_pairs;
+    bool stream;
+    size_t rows_per_task, reals_per_task, chunks_per_row;
+} ew_job;
+
+static bool is_packed(const matrix *mat) {
+    return mat->stride == mat->num_cols || mat->num_rows <= 1;
+}
+
+static void ew_span(const ew_job *job, const matrix_kernels *k, size_t r, size_t c0, size_t n) {
+    size_t offset = c0 * (job->f32 ? sizeof(float) : sizeof(double));
+    char *z = job->z + r * job->ldz + offset;
+
+    if (job->op == EW_ADD) {
+        const char *x = job->x + r * job->ldx + offset;
+        const char *y = job->y + r * job->ldy + offset;
+        if (job->f32) {
+            k->sadd(n, (const float *)x, (float)job->s, (const float *)y, (float *)z, job->stream);
+        } else {
+            k->dadd(n, (const double *)x, job->s, (const double *)y, (double *)z, job->stream);
+        }
+    } else if (job->op == EW_SCALE) {
+        if (job->f32) {
+            k->sscal(n, (float)job->s, (float *)z);
+        } else {
+            k->dscal(n, job->s, (double *)z);
+        }
+    } else if (job->f32) {
+        k->sfill(n, (float)job->fill[0], (float *)z, job->stream);
+    } else if (!job->fill_pairs) {
+        k->dfill(n, job->fill[0], (double *)z, job->stream);
+    } else {
+        // c0 and n are even, so spans start on the real part
+        double *d = (double *)z;
+        for (size_t j = 0; j < n; j += 2) {
+            d[j] = job->fill[0];
+            d[j + 1] = job->fill[1];
+        }
+    }
+}
+
+static void ew_task(void *ctx, size_t task) {
+    const ew_job *job = ctx;
+    const matrix_kernels *k = matrix_kernels_get();
+    size_t r0 = (task / job->chunks_per_row) * job->rows_per_task;
+    size_t c0 = (task % job->chunks_per_row) * job->reals_per_task;
+    size_t r1 = (job->rows - r0 < job->rows_per_task) ? job->rows : r0 + job->rows_per_task;
+    size_t n = (job->width - c0 < job->reals_per_task) ? job->width - c0 : job->reals_per_task;
+    for (size_t r = r0; r < r1; r++) {
+        ew_span(job, k, r, c0, n);
+    }
+}
+
+// Runs job over dst's elements; the job's operands must share dst's type and shape.
+// x and y are only read for EW_ADD.
+static void ew_run(ew_job *job, matrix *dst, const matrix *x, const matrix *y) {
+    size_t esize = dtype_size(dst->dtype);
+    bool packed = is_packed(dst) && (!x || is_packed(x)) && (!y || is_packed(y));
+
+    job->f32 = (dst->dtype == MATRIX_F32);
+    job->rows = packed ? 1 : dst->num_rows;
+    job->width = row_width(dst) * (packed ? dst->num_rows : 1);
+    job->z = dst->data;
+    job->ldz = dst->stride * esize;
+    if (x) {
+        job->x = x->data;
+        job->ldx = x->stride * esize;
+    }
+    if (y) {
+        job->y = y->data;
+        job->ldy = y->stride * esize;
+    }
+
+    size_t total = job->rows * job->width;
+    if (total == 0) {
+        return;
+    }
+    job->stream = job->op != EW_SCALE && total * (job->f32 ? sizeof(float) : sizeof(double)) >= EW_STREAM_MIN &&
+                  (!x || x->data != dst->data) && (!y || y->data != dst->data);
+    unsigned int num_threads = (total < EW_PARALLEL_MIN) ? 1 : matrix_get_num_threads();
+    if (num_threads == 1) {
+        job->rows_per_task = job->rows;
+        job->reals_per_task = job->width;
+        job->chunks_per_row = 1;
+        ew_task(job, 0);
+        return;
+    }
+
+    // Whole rows per task when rows are short, otherwise pieces of one row
+    size_t per_task = total / ((size_t)num_threads * EW_TASKS_PER_THREAD);
+    if (per_task < EW_TASK_MIN) {
+        per_task = EW_TASK_MIN;
+    }
+    if (job->width >= per_task) {
+        job->rows_per_task = 1;
+        job->reals_per_task = (per_task + EW_TASK_ALIGN - 1) / EW_TASK_ALIGN * EW_TASK_ALIGN;
+        job->chunks_per_row = (job->width + job->reals_per_task - 1) / job->reals_per_task;
+    } else {
+        job->rows_per_task = per_task / job->width;
+        job->reals_per_task = job->width;
+        job->chunks_per_row = 1;
+    }
+    size_t num_tasks = ((job->rows + job->rows_per_task - 1) / job->rows_per_task) * job->chunks_per_row;
+    matrix_parallel_for(num_threads, num_tasks, ew_task, job);
+}
+
+// Allocates a zeroed num_rows x num_cols matrix whose rows are `stride` elements apart
+static matrix *matrix_alloc(size_t num_rows, size_t num_cols, size_t stride, size_t element_size) {
     // Check for zero dimensions
     if (num_rows == 0 || num_cols == 0) {
         return NULL;
     }
 
+    // The element size picks the element type
+    matrix_dtype dtype;
+    if (element_size == sizeof(double)) {
+        dtype = MATRIX_F64;
+    } else if (element_size == sizeof(float)) {
+        dtype = MATRIX_F32;
+    } else if (element_size == sizeof(double complex)) {
+        dtype = MATRIX_C128;
+    } else {
+        fprintf(stderr, "Unsupported element size %zu: use sizeof(double), sizeof(float) or sizeof(double _Complex).\n", element_size);
+        return NULL;
+    }
+
     // Calculate total elements and check for overflow
     size_t total_elements;
-    if (__builtin_mul_overflow(num_rows, num_cols, &total_elements)) {
+    if (__builtin_mul_overflow(num_rows, stride, &total_elements)) {
         return NULL;
     }
 
@@ -28,34 +230,79 @@ matrix *matrix_new(unsigned int num_rows, unsigned int num_cols, size_t element_
         return NULL;
     }
 
-    // Check if allocation is too large (arbitrary limit to prevent excessive memory usage)
-    const size_t MAX_ALLOCATION = 1024 * 1024 * 1024; // 1GB limit
-    if (total_size > MAX_ALLOCATION) {
+    // Check if allocation is too large for the configured policy (see matrix_set_max_allocation)
+    if (total_size > matrix_get_max_allocation()) {
         return NULL;
     }
 
     // Allocate matrix struct
-    matrix *mat = calloc(1, sizeof(matrix));
+    matrix *mat = matrix_mem_alloc(sizeof(matrix));
     if (!mat) {
         return NULL;
     }
+    memset(mat, 0, sizeof(matrix));
 
-    // Allocate data array
-    mat->data = calloc(total_elements, element_size);
+    // Allocate the zeroed data array, rounded up to a whole number of alignment units
+    size_t alloc_size = (total_size + MATRIX_ALIGN - 1) & ~(size_t)(MATRIX_ALIGN - 1);
+    mat->data = matrix_mem_data_alloc(alloc_size, MATRIX_ALIGN, &mat->mapped);
     if (!mat->data) {
-        free(mat);
+        matrix_mem_free(mat);
         return NULL;
     }
 
     mat->num_rows = num_rows;
     mat->num_cols = num_cols;
+    mat->stride = stride;
+    mat->dtype = dtype;
+    mat->owns_data = true;
     mat->is_square = (num_rows == num_cols);
 
     return mat;
 }
 
-matrix *matrix_rand(unsigned int num_rows, 
-                    unsigned int num_cols, 
+matrix *matrix_new(size_t num_rows, size_t num_cols, size_t element_size) {
+    return matrix_alloc(num_rows, num_cols, num_cols, element_size);
+}
+
+// Leading dimension for padded rows: a whole number of cache lines, plus one more when
+// that would be a multiple of 1 KiB so rows of power-of-two widths don't alias in L1
+static size_t padded_stride(size_t num_cols, size_t element_size) {
+    if (element_size == 0 || element_size > MATRIX_ALIGN || MATRIX_ALIGN % element_size != 0) {
+        return num_cols;
+    }
+    size_t per_line = MATRIX_ALIGN / element_size;
+    if (num_cols > SIZE_MAX - 2 * per_line) {
+        return num_cols;
+    }
+    size_t stride = (num_cols + per_line - 1) / per_line * per_line;
+    if ((stride * element_size) % 1024 == 0) {
+        stride += per_line;
+    }
+    return stride;
+}
+
+matrix *matrix_new_padded(size_t num_rows, size_t num_cols, size_t element_size) {
+    return matrix_alloc(num_rows, num_cols, padded_stride(num_cols, element_size), element_size);
+}
+
+// Copies the elements of src into dst, which has the same shape but possibly another stride
+static void copy_rows(matrix *dst, const matrix *src) {
+    for (size_t i = 0; i < src->num_rows; i++) {
+        memcpy(row_bytes(dst, i), row_bytes(src, i), src->num_cols * matrix_element_size(src));
+    }
+}
+
+// True if the storage spans of a and b intersect, e.g. a matrix and a view of it
+static bool matrix_overlaps(const matrix *a, const matrix *b) {
+    const char *a0 = (const char *)a->data;
+    const char *b0 = (const char *)b->data;
+    const char *a1 = row_bytes(a, a->num_rows - 1) + a->num_cols * matrix_element_size(a);
+    const char *b1 = row_bytes(b, b->num_rows - 1) + b->num_cols * matrix_element_size(b);
+    return (uintptr_t)a0 < (uintptr_t)b1 && (uintptr_t)b0 < (uintptr_t)a1;
+}
+
+matrix *matrix_rand(size_t num_rows, 
+                    size_t num_cols, 
                     double min, double max, 
                     size_t element_size) {
 
@@ -64,32 +311,31 @@ matrix *matrix_rand(unsigned int num_rows,
       return NULL;
     }
 
-    double *data = (double *)r->data; // Cast to double* for direct access
-    for (unsigned int i = 0; i < num_rows; i++) {
-        for (unsigned int j = 0; j < num_cols; j++) {
-            data[i * num_cols + j] = matrix_rand_interval(min, max);
+    // Complex elements get independent real and imaginary parts in [min, max)
+    for (size_t i = 0; i < num_rows; i++) {
+        for (size_t j = 0; j < num_cols; j++) {
+            double re = matrix_rand_interval(min, max);
+            double im = (r->dtype == MATRIX_C128) ? matrix_rand_interval(min, max) : 0.0;
+            matrix_put_c(r, i, j, re + im * I);
         }
     }
     return r;
 }
 
 
-matrix *matrix_sqr(unsigned int size, size_t element_size) {
+matrix *matrix_sqr(size_t size, size_t element_size) {
   return matrix_new(size, size, element_size);  
 }
 
-matrix *matrix_eye(unsigned int size, size_t element_size, const void *identity_element) {
+matrix *matrix_eye(size_t size, size_t element_size, const void *identity_element) {
     matrix *r = matrix_new(size, size, element_size);
     if (!r) {
         return NULL;
     }
 
-    // Initialize all elements to 0
-    memset(r->data, 0, size * size * element_size);
-
-    // Set diagonal elements to the identity element
-    for (unsigned int i = 0; i < size; i++) {
-        memcpy((char*)r->data + (i * size + i) * element_size, identity_element, element_size);
+    // Set diagonal elements to the identity element; matrix_new already zeroed the rest
+    for (size_t i = 0; i < size; i++) {
+        memcpy((char*)r->data + ((size_t)i * r->stride + i) * element_size, identity_element, element_size);
     }
 
     return r;
@@ -101,8 +347,10 @@ void matrix_free(matrix *mat) {
     return;
   }
 
-  free(mat->data); 
-  free(mat);
+  if (mat->owns_data) {
+    matrix_mem_data_free(mat->data, mat->mapped);
+  }
+  matrix_mem_free(mat);
 }
 
 void matrix_print(const matrix *matrix) {
@@ -117,9 +365,15 @@ void matrix_printf(const matrix *matrix, const char *d_fmt) {
 
     fprintf(stdout, "\n");
     
-    for(unsigned int i = 0; i < matrix->num_rows; ++i) {
-        for(unsigned int j = 0; j < matrix->num_cols; ++j) {
-            double value = ((double *)(matrix->data))[i * matrix->num_cols + j];
+    for(size_t i = 0; i < matrix->num_rows; ++i) {
+        for(size_t j = 0; j < matrix->num_cols; ++j) {
+            if (matrix->dtype == MATRIX_C128) {
+                // Complex elements print as re+imi, whatever d_fmt says
+                double complex value = matrix_get_c(matrix, i, j);
+                fprintf(stdout, "%g%+gi\t", creal(value), cimag(value));
+                continue;
+            }
+            double value = matrix_get(matrix, i, j);
             fprintf(stdout, d_fmt, value); 
         }
         fprintf(stdout, "\n");
@@ -141,15 +395,14 @@ int matrix_eq(const matrix *m1, const matrix *m2, double tolerance) {
         return 0;
     }
 
-    for (unsigned int i = 0; i < m1->num_rows; i++) {
-        for (unsigned int j = 0; j < m1->num_cols; j++) {
-            size_t element_size = sizeof(double); // Assuming elements are type double
-            size_t index = i * m1->num_cols * element_size + j * element_size;
-            double *elem1 = (double*)((char*)m1->data + index);
-            double *elem2 = (double*)((char*)m2->data + index);
-            
-            if (fabs(*elem1 - *elem2) > tolerance) {
-                printf("Mismatch in row %u and column %u\n", i, j); // Use %u for unsigned integers
+    for (size_t i = 0; i < m1->num_rows; i++) {
+        for (size_t j = 0; j < m1->num_cols; j++) {
+            // Any element types, so a float result can be checked against a double reference
+            double complex elem1 = matrix_get_c(m1, i, j);
+            double complex elem2 = matrix_get_c(m2, i, j);
+
+            if (cabs(elem1 - elem2) > tolerance) {
+                printf("Mismatch in row %zu and column %zu\n", i, j);
                 return 0;
             }
         }
@@ -158,25 +411,44 @@ int matrix_eq(const matrix *m1, const matrix *m2, double tolerance) {
     return 1; // If we reach here, matrices are equal within the specified tolerance
 }
 
-double matrix_at(const matrix *mat, unsigned int i, unsigned int j) {
-    if (!mat || !mat->data || i >= mat->num_rows || j >= mat->num_cols) {
-        fprintf(stderr, "Invalid matrix access: matrix=%p, data=%p, i=%u, j=%u, num_rows=%u, num_cols=%u\n",
+_Noreturn void matrix_bounds_fail(const matrix *mat, size_t i, size_t j) {
+    if (!mat) {
+        fprintf(stderr, "Invalid matrix access: matrix=NULL, i=%zu, j=%zu\n", i, j);
+    } else {
+        fprintf(stderr, "Invalid matrix access: matrix=%p, data=%p, i=%zu, j=%zu, num_rows=%zu, num_cols=%zu\n",
                (void*) mat, (void*)mat->data, i, j, mat->num_rows, mat->num_cols);
-        exit(EXIT_FAILURE);
     }
-        return ((double*)mat->data)[i * mat->num_cols + j];
+    exit(EXIT_FAILURE);
+}
+
+// Always bounds-checked, whatever MATRIX_CHECKED says; hot loops use matrix_get instead
+double matrix_at(const matrix *mat, size_t i, size_t j) {
+    if (!mat || !mat->data || i >= mat->num_rows || j >= mat->num_cols) {
+        matrix_bounds_fail(mat, i, j);
+    }
+    return matrix_get(mat, i, j);
 }
 
+#define SYMMETRY_TILE 32
+
 bool matrix_is_symmetric(matrix *mat){
     if(!mat || !mat->data || !mat->is_square) {
         return false; // Non-square matrices are not symmetric
     }
 
-    for (unsigned int i = 0; i < mat->num_rows; i++) {
-        for(unsigned int j = 0; j < mat->num_cols; j++) {
-
-            if(matrix_at(mat, i, j) != matrix_at(mat, j, i)) {
-                return false; // Elements are not equal across diag, so matrix is not symmetric
+    // Compare tile against mirrored tile, so the column walk of the transposed side
+    // stays within a few cache lines instead of striding down the whole matrix
+    size_t n = mat->num_rows;
+    for (size_t i0 = 0; i0 < n; i0 += SYMMETRY_TILE) {
+        size_t i1 = (n - i0 < SYMMETRY_TILE) ? n : i0 + SYMMETRY_TILE;
+        for (size_t j0 = i0; j0 < n; j0 += SYMMETRY_TILE) {
+            size_t j1 = (n - j0 < SYMMETRY_TILE) ? n : j0 + SYMMETRY_TILE;
+            for (size_t i = i0; i < i1; i++) {
+                for (size_t j = (j0 > i) ? j0 : i + 1; j < j1; j++) {
+                    if(matrix_get_c(mat, i, j) != matrix_get_c(mat, j, i)) {
+                        return false; // Elements are not equal across diag, so matrix is not symmetric
+                    }
+                }
             }
         }
     }
@@ -185,112 +457,179 @@ bool matrix_is_symmetric(matrix *mat){
 
 
 bool matrix_is_posdef(matrix *mat) {
-    // Check if all leading principal minors (determinants of submatrices) are positive
-    unsigned int n = mat->num_rows;
-    matrix_lup *lup = matrix_lup_solve(mat);
-    double determinant = 1.0;
-
-    for (unsigned int i = 0; i < n; i++) {
-        determinant *= matrix_at(lup->U, i, i);
-        if (determinant <= 0) {
-            matrix_lup_free(lup);
-            return false;
+    if (!mat || !mat->data || !mat->is_square || mat->dtype == MATRIX_C128) {
+        return false;
+    }
+
+    // Check if all leading principal minors (determinants of submatrices) are positive,
+    // factoring a scratch copy (in double, whatever the element type) rather than
+    // building a matrix_lup
+    size_t n = mat->num_rows;
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    double *a = matrix_scratch_alloc(mark, (size_t)n * n * sizeof(double));
+    size_t *ipiv = matrix_scratch_alloc(mark, n * sizeof(size_t));
+    if (!a || !ipiv) {
+        matrix_scratch_end(mark);
+        return false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a[i * n + j] = matrix_get(mat, i, j);
         }
     }
 
-    matrix_lup_free(lup);
-    return true;
+    bool posdef = (matrix_dgetrf(n, a, n, ipiv) == 0); // Singular matrices are not positive definite
+    double determinant = 1.0;
+    for (size_t i = 0; posdef && i < n; i++) {
+        determinant *= a[(size_t)i * n + i];
+        posdef = (determinant > 0);
+    }
+
+    matrix_scratch_end(mark);
+    return posdef;
 }
 
 
+// Owning copy of a block; matrix_view gives the same block without copying
 matrix *matrix_slice(matrix *mat, Range row_range, Range col_range) {
-    // Check if all rows are needed
-    if (row_range.start == -1) {
-        if (col_range.start == -1) { // All rows, all columns
-            return matrix_copy(mat);
-        } else {
-            return matrix_submatrix(mat, row_range, col_range);
-        }
-    } else { 
-      // All other cases of single column or range of columns will just be a matrix_submatrix call
-            return matrix_submatrix(mat, row_range, col_range);
-    }
-    
-    printf("matrix slice not successfully executed.");
-    return NULL;   
+    return matrix_submatrix(mat, row_range, col_range);
 }
 
 
-matrix *matrix_submatrix(const matrix *mat, Range row_range, Range col_range) {
-     // Check for negative indices for start
-    if (row_range.start < -1 || col_range.start < -1) {
+// Resolves a row or column range against a dimension of size `dim`; -1 as start or end
+// means the first or last index. Returns false if the range is empty or out of bounds.
+static bool range_resolve(Range range, size_t dim, size_t *start, size_t *end) {
+    // Check for negative indices for start
+    if (range.start < -1) {
         fprintf(stderr, "Invalid start index in range\n");
-        return NULL;
+        return false;
     }
 
     // Check for negative indices for end, not including -1
-    if ((row_range.end < -1) || (col_range.end < -1)) {
+    if (range.end < -1) {
         fprintf(stderr, "Invalid end index in range\n");
-        return NULL;
+        return false;
     }
 
-    // Determine the start indices, handling the -1 case
-    unsigned int row_start = (row_range.start == -1) ? 0 : row_range.start;
-    unsigned int col_start = (col_range.start == -1) ? 0 : col_range.start;
-
-    // Determine the end indices, handling the -1 case
-    unsigned int row_end = (row_range.end == -1) ? (mat->num_rows) : (unsigned int)row_range.end;
-    unsigned int col_end = (col_range.end == -1) ? (mat->num_cols) : (unsigned int)col_range.end;
+    *start = (range.start == -1) ? 0 : (size_t)range.start;
+    *end = (range.end == -1) ? dim : (size_t)range.end;
 
-    // Check if end indices exceed matrix dimensions
-    if ((row_end - 1) > mat->num_rows || (col_end - 1) > mat->num_cols) {
+    // Check if the range is empty or exceeds the matrix dimensions
+    if (*end > dim || *start >= *end) {
         fprintf(stderr, "Range end exceeds matrix dimensions\n");
-        return NULL;
+        return false;
+    }
+    return true;
+}
+
+// A non-owning matrix over rows [r0, r0 + rows) and columns [c0, c0 + cols) of mat
+static matrix view_at(const matrix *mat, size_t r0, size_t c0, size_t rows, size_t cols) {
+    matrix view = {
+        .num_rows = rows,
+        .num_cols = cols,
+        .stride = mat->stride,
+        .data = row_bytes(mat, r0) + c0 * matrix_element_size(mat),
+        .dtype = mat->dtype,
+        .owns_data = false,
+        .is_square = (rows == cols),
+    };
+    return view;
+}
+
+matrix matrix_view(const matrix *mat, Range row_range, Range col_range) {
+    matrix empty = {0};
+    if (!mat || !mat->data) {
+        return empty;
+    }
+
+    size_t row_start, row_end, col_start, col_end;
+    if (!range_resolve(row_range, mat->num_rows, &row_start, &row_end) ||
+        !range_resolve(col_range, mat->num_cols, &col_start, &col_end)) {
+        return empty;
+    }
+    return view_at(mat, row_start, col_start, row_end - row_start, col_end - col_start);
+}
+
+matrix matrix_row_view(const matrix *mat, size_t row) {
+    matrix empty = {0};
+    if (!mat || !mat->data || row >= mat->num_rows) {
+        return empty;
     }
+    return view_at(mat, row, 0, 1, mat->num_cols);
+}
 
-    // Calculate new dimensions
-    unsigned int new_rows = (row_range.end == -1) ? row_end : row_end - row_start;
-    unsigned int new_cols = (col_range.end == -1) ? col_end : col_end - col_start;    
+matrix matrix_col_view(const matrix *mat, size_t col) {
+    matrix empty = {0};
+    if (!mat || !mat->data || col >= mat->num_cols) {
+        return empty;
+    }
+    return view_at(mat, 0, col, mat->num_rows, 1);
+}
 
+matrix *matrix_submatrix(const matrix *mat, Range row_range, Range col_range) {
+    matrix view = matrix_view(mat, row_range, col_range);
+    if (!view.data) {
+        return NULL;
+    }
 
-    matrix *submat = matrix_new(new_rows, new_cols, sizeof(double));
+    matrix *submat = matrix_copy(&view);
     if (!submat) {
         fprintf(stderr, "Failed to allocate memory for submatrix\n");
         return NULL;
     }
+    return submat;
+}
 
-    // Copy data from the original matrix to the submatrix
-    for (unsigned int i = 0; i < new_rows; ++i) {
-        for (unsigned int j = 0; j < new_cols; ++j) {
-            ((double*)submat->data)[i * new_cols + j] = 
-                ((double*)mat->data)[(row_start + i) * mat->num_cols + (col_start + j)];
-        }
-    }
+matrix *matrix_row_get(const matrix *mat, size_t row_num) {
+    matrix view = matrix_row_view(mat, row_num);
+    return view.data ? matrix_copy(&view) : NULL;
+}
 
-    return submat;
+matrix *matrix_col_get(const matrix *mat, size_t col_num) {
+    matrix view = matrix_col_view(mat, col_num);
+    return view.data ? matrix_copy(&view) : NULL;
 }
 
-void matrix_set(matrix *mat, unsigned int i, unsigned int j, double value) {
+void matrix_set(matrix *mat, size_t i, size_t j, double value) {
     if (mat == NULL || i >= mat->num_rows || j >= mat->num_cols) {
         // Check for invalid input or matrix dimensions
         return;  // Return without making any changes
     }
 
-    // Calculate the index in the matrix data array for the specified element
-    unsigned int index = i * mat->num_cols + j;
-
-    // Update the value at the specified index
-    ((double *)mat->data)[index] = value;
+    // Update the value at the specified position
+    matrix_put(mat, i, j, value);
 }
 
+// Reads the value given to matrix_all_set or matrix_diag_set, a double, a float or a
+// double _Complex whatever the matrix's own element type. Returns false for any other size.
+static bool read_value(const void *value, size_t value_size, double complex *out) {
+    if (value_size == sizeof(double)) {
+        double d;
+        memcpy(&d, value, sizeof(double));
+        *out = d;
+        return true;
+    }
+    if (value_size == sizeof(float)) {
+        float f;
+        memcpy(&f, value, sizeof(float));
+        *out = f;
+        return true;
+    }
+    if (value_size == sizeof(double complex)) {
+        memcpy(out, value, sizeof(double complex));
+        return true;
+    }
+    fprintf(stderr, "Unsupported value size %zu: use sizeof(double), sizeof(float) or sizeof(double _Complex).\n", value_size);
+    return false;
+}
 
 void matrix_all_set(matrix *mat, const void *value, size_t value_size) {
-    for (unsigned int i = 0; i < mat->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat->num_cols; ++j) {
-            unsigned int index = i * mat->num_cols + j;
-            memcpy((char *)mat->data + index * value_size, value, value_size);
-        }
+    double complex v;
+    if (!read_value(value, value_size, &v)) {
+        return;
     }
+    ew_job job = { .op = EW_FILL, .fill = { creal(v), cimag(v) }, .fill_pairs = (mat->dtype == MATRIX_C128) };
+    ew_run(&job, mat, NULL, NULL);
 }
 
 void matrix_diag_set(matrix *mat, const void *value, size_t value_size) {
@@ -300,11 +639,36 @@ void matrix_diag_set(matrix *mat, const void *value, size_t value_size) {
         return;
     }
 
-    unsigned int min_dim = mat->num_rows;  // Since the matrix is square, num_rows == num_cols
-    for (unsigned int i = 0; i < min_dim; ++i) {
-        unsigned int index = i * mat->num_cols + i;
-        memcpy((char *)mat->data + index * value_size, value, value_size);
+    double complex v;
+    if (!read_value(value, value_size, &v)) {
+        return;
+    }
+    size_t min_dim = mat->num_rows;  // Since the matrix is square, num_rows == num_cols
+    for (size_t i = 0; i < min_dim; ++i) {
+        matrix_put_c(mat, i, i, v);
+    }
+}
+
+matrix *matrix_copy_into(matrix *dst, const matrix *src) {
+    if (!dst || !src || !matrix_eqdim(dst, src)) {
+        fprintf(stderr, "Matrices dimensions do not match.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, src)) {
+        return NULL;
+    }
+
+    // Copying a matrix onto itself is a no-op; partially overlapping views are refused
+    if (dst->data == src->data && dst->stride == src->stride) {
+        return dst;
+    }
+    if (matrix_overlaps(dst, src)) {
+        fprintf(stderr, "Output matrix must not overlap the source matrix.\n");
+        return NULL;
     }
+
+    copy_rows(dst, src);
+    return dst;
 }
 
 matrix *matrix_copy(const matrix *src) {
@@ -312,258 +676,589 @@ matrix *matrix_copy(const matrix *src) {
         return NULL; // Handle null source matrix
     }
 
-    // Manually allocate memory for the new matrix structure
-    matrix *copy = malloc(sizeof(matrix));
+    // Same shape and stride, so the padding (if any) carries over; a view's stride is
+    // its parent's, so copies of views are packed
+    size_t stride = src->owns_data ? src->stride : src->num_cols;
+    matrix *copy = matrix_alloc(src->num_rows, src->num_cols, stride, matrix_element_size(src));
     if (!copy) {
         return NULL; // Handle memory allocation failure
     }
 
-    // Copy the matrix structure (excluding the data pointer)
-    *copy = *src;
-
-    // Allocate memory for the data array and copy the data
-    copy->data = malloc(src->num_rows * src->num_cols * sizeof(double));
-    if (!copy->data) {
-        free(copy); // Clean up if data allocation fails
-        return NULL;
-    }
-    memcpy(copy->data, src->data, src->num_rows * src->num_cols * sizeof(double));
+    copy_rows(copy, src);
 
     return copy;
 }
 
-void matrix_transpose(matrix *mat) {
-    if (mat == NULL) {
-        return; // Handle null matrix
+matrix *matrix_convert(const matrix *src, matrix_dtype dtype) {
+    if (!src || !src->data) {
+        return NULL;
     }
-
-    // Create a new matrix to store the transpose
-    matrix *transposed = matrix_new(mat->num_cols, mat->num_rows, sizeof(double));
-    if (!transposed) {
-        return; // Handle memory allocation failure
+    if (src->dtype == dtype) {
+        return matrix_copy(src);
     }
 
-    // Transpose the data
-    for (unsigned int i = 0; i < mat->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat->num_cols; ++j) {
-            ((double*)transposed->data)[j * mat->num_rows + i] = 
-                ((double*)mat->data)[i * mat->num_cols + j];
+    matrix *dst = matrix_new(src->num_rows, src->num_cols, dtype_size(dtype));
+    if (!dst) {
+        return NULL;
+    }
+    for (size_t i = 0; i < src->num_rows; i++) {
+        for (size_t j = 0; j < src->num_cols; j++) {
+            matrix_put_c(dst, i, j, matrix_get_c(src, i, j));
         }
     }
-
-    // Replace original matrix data with transposed data
-    free(mat->data);
-    mat->data = transposed->data;
-    mat->num_rows = transposed->num_rows;
-    mat->num_cols = transposed->num_cols;
-
-    // Free the transposed matrix structure without freeing its data
-    free(transposed);
+    return dst;
 }
 
-matrix *matrix_stackv(const matrix *mat1, const matrix *mat2) {
-    if (mat1 == NULL || mat2 == NULL) {
-        return NULL; // Handle null matrices
-    }
+// Blocks handed to the transpose kernels: 32 x 32 doubles is 8 KiB, so the source
+// and destination blocks sit in L1 together
+#define TRANSPOSE_TILE 32
+
+// What the recursive transposes below need to know about the element type
+typedef struct {
+    matrix_dtype dtype;
+    size_t esize;
+    bool conj;  // conjugate complex elements on the way
+    const matrix_kernels *k;
+} transpose_op;
+
+static transpose_op transpose_op_for(const matrix *mat, bool conj) {
+    transpose_op t = {
+        .dtype = mat->dtype,
+        .esize = matrix_element_size(mat),
+        .conj = conj && mat->dtype == MATRIX_C128,
+        .k = matrix_kernels_get(),
+    };
+    return t;
+}
 
-    // Check if both matrices have the same number of columns
-    if (mat1->num_cols != mat2->num_cols) {
-        fprintf(stderr, "Error: Matrices must have the same number of columns to stack.\n");
-        return NULL;
+// Complex tiles move one 16-byte element at a time; strides count complex elements
+static void ztranspose_tile(size_t rows, size_t cols, const double *src, size_t lds,
+                            double *dst, size_t ldd, bool conj) {
+    double sign = conj ? -1.0 : 1.0;
+    for (size_t i = 0; i < rows; i++) {
+        const double *s = src + 2 * i * lds;
+        for (size_t j = 0; j < cols; j++) {
+            double *d = dst + 2 * (j * ldd + i);
+            d[0] = s[2 * j];
+            d[1] = sign * s[2 * j + 1];
+        }
     }
+}
 
-    // Create a new matrix to store the stacked matrices
-    unsigned int new_rows = mat1->num_rows + mat2->num_rows;
-    matrix *stacked = matrix_new(new_rows, mat1->num_cols, sizeof(double));
-    if (!stacked) {
-        return NULL; // Handle memory allocation failure
+// dst = src^T for a block of at most one tile per side; strides count elements
+static void transpose_tile(const transpose_op *t, size_t rows, size_t cols,
+                           const char *src, size_t lds, char *dst, size_t ldd) {
+    switch (t->dtype) {
+        case MATRIX_F64:
+            t->k->dtranspose(rows, cols, (const double *)src, lds, (double *)dst, ldd);
+            break;
+        case MATRIX_F32:
+            t->k->stranspose(rows, cols, (const float *)src, lds, (float *)dst, ldd);
+            break;
+        default:
+            ztranspose_tile(rows, cols, (const double *)src, lds, (double *)dst, ldd, t->conj);
+            break;
     }
+}
 
-    // Copy data from mat1 into the first part of stacked
-    memcpy(stacked->data, mat1->data, mat1->num_rows * mat1->num_cols * sizeof(double));
-    
-    // Copy data from mat2 into the second part of stacked
-    memcpy((char*)stacked->data + mat1->num_rows * mat1->num_cols * sizeof(double), 
-           mat2->data, mat2->num_rows * mat2->num_cols * sizeof(double));
-
-    return stacked;
+// Where to cut a side of n > TRANSPOSE_TILE elements: half-way, rounded to whole tiles
+static size_t transpose_split(size_t n) {
+    return (n + 2 * TRANSPOSE_TILE - 1) / (2 * TRANSPOSE_TILE) * TRANSPOSE_TILE;
 }
 
-matrix *matrix_stackh(const matrix *mat1, const matrix *mat2) {
-    if (mat1 == NULL || mat2 == NULL) {
-        return NULL; // Handle null matrices
+// Cache-oblivious dst = src^T: halving the longer side until a block is one tile gives
+// blocks that fit every cache level on the way down, whatever their sizes
+static void transpose_blocks(const transpose_op *t, size_t rows, size_t cols,
+                             const char *src, size_t lds, char *dst, size_t ldd) {
+    if (rows <= TRANSPOSE_TILE && cols <= TRANSPOSE_TILE) {
+        transpose_tile(t, rows, cols, src, lds, dst, ldd);
+    } else if (rows >= cols) {
+        size_t h = transpose_split(rows);
+        transpose_blocks(t, h, cols, src, lds, dst, ldd);
+        transpose_blocks(t, rows - h, cols, src + h * lds * t->esize, lds, dst + h * t->esize, ldd);
+    } else {
+        size_t h = transpose_split(cols);
+        transpose_blocks(t, rows, h, src, lds, dst, ldd);
+        transpose_blocks(t, rows, cols - h, src + h * t->esize, lds, dst + h * ldd * t->esize, ldd);
     }
+}
 
-    // Check if both matrices have the same number of rows
-    if (mat1->num_rows != mat2->num_rows) {
-        fprintf(stderr, "Error: Matrices must have the same number of rows to stack horizontally.\n");
-        return NULL;
+// Swaps x (rows x cols) with the transpose of y (cols x rows), both at stride ld, as
+// the mirrored off-diagonal blocks of an in-place square transpose
+static void transpose_swap_blocks(const transpose_op *t, size_t rows, size_t cols, char *x, char *y, size_t ld) {
+    size_t es = t->esize;
+    if (rows > TRANSPOSE_TILE || cols > TRANSPOSE_TILE) {
+        if (rows >= cols) {
+            size_t h = transpose_split(rows);
+            transpose_swap_blocks(t, h, cols, x, y, ld);
+            transpose_swap_blocks(t, rows - h, cols, x + h * ld * es, y + h * es, ld);
+        } else {
+            size_t h = transpose_split(cols);
+            transpose_swap_blocks(t, rows, h, x, y, ld);
+            transpose_swap_blocks(t, rows, cols - h, x + h * es, y + h * ld * es, ld);
+        }
+        return;
     }
 
-    // Create a new matrix to store the horizontally stacked matrices
-    unsigned int new_cols = mat1->num_cols + mat2->num_cols;
-    matrix *stacked = matrix_new(mat1->num_rows, new_cols, sizeof(double));
-    if (!stacked) {
-        return NULL; // Handle memory allocation failure
+    // x^T is parked in a tile buffer while y^T overwrites x
+    _Alignas(MATRIX_ALIGN) char buf[TRANSPOSE_TILE * TRANSPOSE_TILE * sizeof(double complex)];
+    transpose_tile(t, rows, cols, x, ld, buf, rows);
+    transpose_tile(t, cols, rows, y, ld, x, ld);
+    for (size_t i = 0; i < cols; i++) {
+        memcpy(y + i * ld * es, buf + i * rows * es, rows * es);
     }
-
-    // Copy data from mat1 and mat2 into the stacked matrix
-    for (unsigned int i = 0; i < mat1->num_rows; ++i) {
-        // Copy data from mat1
-        memcpy((char*)stacked->data + i * new_cols * sizeof(double),
-            (char*)mat1->data + i * mat1->num_cols * sizeof(double),
-            mat1->num_cols * sizeof(double));
-
-
-        // Copy data from mat2
-        memcpy((char*)stacked->data + (i * new_cols + mat1->num_cols) * sizeof(double), 
-           (char*)mat2->data + i * mat2->num_cols * sizeof(double), 
-           mat2->num_cols * sizeof(double));
-    } 
-
-    return stacked;
-
 }
 
-/*Matrix math operations*/
-
-void matrix_row_mult_r(matrix *mat, unsigned int row, double value) {
-    if (row >= mat->num_rows) {
-        fprintf(stderr, "Row index out of bounds\n");
-        return;
+// Moves one element of a size known to the caller's switch, so memcpy inlines
+static inline void move_element(char *dst, const char *src, size_t es) {
+    switch (es) {
+        case sizeof(float):
+            memcpy(dst, src, sizeof(float));
+            break;
+        case sizeof(double):
+            memcpy(dst, src, sizeof(double));
+            break;
+        default:
+            memcpy(dst, src, sizeof(double complex));
+            break;
     }
+}
 
-    for (unsigned int j = 0; j < mat->num_cols; ++j) {
-        ((double *)mat->data)[row * mat->num_cols + j] *= value;
+// Negates the imaginary part of n complex elements
+static void conj_elements(size_t n, double *z) {
+    for (size_t i = 0; i < n; i++) {
+        z[2 * i + 1] = -z[2 * i + 1];
     }
 }
 
-void matrix_col_mult_r(matrix *mat, unsigned int col, double value) {
-    if (col >= mat->num_cols) {
-        fprintf(stderr, "Column index out of bounds\n");
+// In-place transpose of the n x n matrix at a: the diagonal halves recurse, the two
+// off-diagonal blocks are swapped through their transposes
+static void transpose_square(const transpose_op *t, size_t n, char *a, size_t ld) {
+    size_t es = t->esize;
+    if (n > TRANSPOSE_TILE) {
+        size_t h = transpose_split(n);
+        transpose_square(t, h, a, ld);
+        transpose_square(t, n - h, a + h * (ld + 1) * es, ld);
+        transpose_swap_blocks(t, h, n - h, a + h * es, a + h * ld * es, ld);
         return;
     }
 
-    for (unsigned int i = 0; i < mat->num_rows; ++i) {
-        ((double *)mat->data)[i * mat->num_cols + col] *= value;
+    char tmp[sizeof(double complex)];
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            char *x = a + (i * ld + j) * es, *y = a + (j * ld + i) * es;
+            move_element(tmp, x, es);
+            move_element(x, y, es);
+            move_element(y, tmp, es);
+        }
+        if (t->conj) {
+            conj_elements(n, (double *)(a + i * ld * es));
+        }
     }
 }
 
-void matrix_mult_r(matrix *mat, double value) {
-    for (unsigned int i = 0; i < mat->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat->num_cols; ++j) {
-            ((double *)mat->data)[i * mat->num_cols + j] *= value;
+// In-place transpose of a packed rows x cols matrix by following the cycles of the
+// permutation: the element that lands at q = j * rows + i starts at p = i * cols + j.
+// `done` has a zeroed bit per element, marking the positions already filled.
+static void transpose_cycles(const transpose_op *t, size_t rows, size_t cols, char *a, uint64_t *done) {
+    size_t n = rows * cols, es = t->esize;
+    char tmp[sizeof(double complex)];
+    // The first and last elements stay put
+    for (size_t q0 = 1; q0 + 1 < n; q0++) {
+        if (done[q0 / 64] == UINT64_MAX) {
+            q0 |= 63;
+            continue;
+        }
+        if (done[q0 / 64] & ((uint64_t)1 << (q0 % 64))) {
+            continue;
+        }
+        move_element(tmp, a + q0 * es, es);
+        size_t q = q0;
+        for (;;) {
+            done[q / 64] |= (uint64_t)1 << (q % 64);
+            size_t p = (q % rows) * cols + q / rows;
+            if (p == q0) {
+                break;
+            }
+            move_element(a + q * es, a + p * es, es);
+            q = p;
         }
+        move_element(a + q * es, tmp, es);
+    }
+    if (t->conj) {
+        conj_elements(n, (double *)a);
+    }
+}
+
+// Transposes mat into dst, conjugating complex elements when conj is set
+static matrix *transpose_into(matrix *dst, const matrix *mat, bool conj) {
+    if (!dst || !mat) {
+        return NULL;
     }
+    if (dst->num_rows != mat->num_cols || dst->num_cols != mat->num_rows) {
+        fprintf(stderr, "Output matrix must be %zu x %zu to hold the transpose.\n", mat->num_cols, mat->num_rows);
+        return NULL;
+    }
+    if (matrix_overlaps(dst, mat)) {
+        fprintf(stderr, "Output matrix must not overlap the matrix being transposed.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat)) {
+        return NULL;
+    }
+
+    transpose_op t = transpose_op_for(mat, conj);
+    transpose_blocks(&t, mat->num_rows, mat->num_cols, mat->data, mat->stride, dst->data, dst->stride);
+    return dst;
+}
+
+matrix *matrix_transpose_into(matrix *dst, const matrix *mat) {
+    return transpose_into(dst, mat, false);
+}
+
+matrix *matrix_conj_transpose_into(matrix *dst, const matrix *mat) {
+    return transpose_into(dst, mat, true);
 }
 
-void matrix_row_addrow(matrix *mat, unsigned int row1_index, unsigned int row2_index, double factor) {
+// Replaces mat's data with its (conjugate) transpose without a second buffer: square
+// matrices swap mirrored blocks, others follow the permutation's cycles, which needs
+// one bit of scratch per element
+static void transpose_in_place(matrix *mat, bool conj) {
     if (mat == NULL) {
         return; // Handle null matrix
     }
-
-    // Check if row indices are within the bounds of the matrix
-    if (row1_index >= mat->num_rows || row2_index >= mat->num_rows) {
-        fprintf(stderr, "Error: Your matrix 1 or matrix 2 Row index selection is out of bounds.\n");
+    if (!mat->owns_data) {
+        fprintf(stderr, "Cannot transpose a view in place\n");
         return;
     }
 
-    // Perform the row addition with the specified factor
-    for (unsigned int i = 0; i < mat->num_cols; ++i) {
-        double row1_value = ((double*)mat->data)[row1_index * mat->num_cols + i];
-        double row2_value = ((double*)mat->data)[row2_index * mat->num_cols + i];
-        ((double*)mat->data)[row2_index * mat->num_cols + i] = row2_value + (factor * row1_value);
+    transpose_op t = transpose_op_for(mat, conj);
+    size_t rows = mat->num_rows, cols = mat->num_cols, es = t.esize;
+    char *a = mat->data;
+    if (rows == cols) {
+        transpose_square(&t, rows, a, mat->stride);
+        return;
     }
-}
 
+    size_t n = rows * cols;
+    uint64_t *done = matrix_mem_alloc((n + 63) / 64 * sizeof(uint64_t));
+    if (!done) {
+        return; // Handle memory allocation failure
+    }
+    memset(done, 0, (n + 63) / 64 * sizeof(uint64_t));
 
-matrix *matrix_row_rem(matrix *mat, unsigned int row) {
-    if (row >= mat->num_rows) {
-        fprintf(stderr, "Row index out of bounds\n");
-        return mat;
+    // Padded rows are squeezed together first and spread out again afterwards, with
+    // the padding for the new width if the buffer (rows * stride elements) holds it
+    bool padded = (mat->stride != cols);
+    for (size_t i = 1; padded && i < rows; i++) {
+        memmove(a + i * cols * es, a + i * mat->stride * es, cols * es);
     }
+    transpose_cycles(&t, rows, cols, a, done);
+    matrix_mem_free(done);
 
-    unsigned int new_rows = mat->num_rows - 1;
-    matrix *new_mat = matrix_new(new_rows, mat->num_cols, sizeof(double));
-    if (!new_mat) {
-        return NULL; // Failed to allocate new matrix, return the original
+    size_t stride = padded ? padded_stride(rows, es) : rows;
+    if (cols * stride > rows * mat->stride) {
+        stride = rows;
+    }
+    for (size_t i = cols; stride != rows && i-- > 1;) {
+        memmove(a + i * stride * es, a + i * rows * es, rows * es);
     }
 
-    double *new_data = (double *)new_mat->data;
-    double *old_data = (double *)mat->data;
+    mat->num_rows = cols;
+    mat->num_cols = rows;
+    mat->stride = stride;
+    mat->is_square = false;
+}
 
-    for (unsigned int i = 0, new_i = 0; i < mat->num_rows; i++) {
-        if (i == row) { 
-            continue; // Skip the row to be removed
-        }
-        for (unsigned int j = 0; j < mat->num_cols; j++) {
-            new_data[new_i * mat->num_cols + j] = old_data[i * mat->num_cols + j];
-        }
-        new_i++;
-    }
+void matrix_transpose(matrix *mat) {
+    transpose_in_place(mat, false);
+}
 
-    matrix_free(mat); // Free the old matrix
-    return new_mat;   // Return the new matrix
+void matrix_conj_transpose(matrix *mat) {
+    transpose_in_place(mat, true);
 }
 
+matrix *matrix_stackv_into(matrix *dst, const matrix *mat1, const matrix *mat2) {
+    if (dst == NULL || mat1 == NULL || mat2 == NULL) {
+        return NULL; // Handle null matrices
+    }
 
-matrix *matrix_col_rem(matrix *mat, unsigned int col) {
-    if (col >= mat->num_cols) {
+    // Check if both matrices have the same number of columns
+    if (mat1->num_cols != mat2->num_cols) {
+        fprintf(stderr, "Error: Matrices must have the same number of columns to stack.\n");
+        return NULL;
+    }
+    if (dst->num_rows != mat1->num_rows + mat2->num_rows || dst->num_cols != mat1->num_cols) {
+        fprintf(stderr, "Error: Output matrix has the wrong dimensions for the stacked matrices.\n");
+        return NULL;
+    }
+    if (matrix_overlaps(dst, mat1) || matrix_overlaps(dst, mat2)) {
+        fprintf(stderr, "Error: Output matrix must not overlap the matrices being stacked.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat1) || !same_dtype(dst, mat2)) {
+        return NULL;
+    }
+
+    // Copy the rows of mat1 and then those of mat2 into dst
+    size_t row_size = mat1->num_cols * matrix_element_size(dst);
+    for (size_t i = 0; i < mat1->num_rows; ++i) {
+        memcpy(row_bytes(dst, i), row_bytes(mat1, i), row_size);
+    }
+    for (size_t i = 0; i < mat2->num_rows; ++i) {
+        memcpy(row_bytes(dst, mat1->num_rows + i), row_bytes(mat2, i), row_size);
+    }
+
+    return dst;
+}
+
+matrix *matrix_stackv(const matrix *mat1, const matrix *mat2) {
+    if (mat1 == NULL || mat2 == NULL) {
+        return NULL; // Handle null matrices
+    }
+
+    // Check if both matrices have the same number of columns
+    if (mat1->num_cols != mat2->num_cols) {
+        fprintf(stderr, "Error: Matrices must have the same number of columns to stack.\n");
+        return NULL;
+    }
+
+    // Create a new matrix to store the stacked matrices
+    size_t new_rows = mat1->num_rows + mat2->num_rows;
+    matrix *stacked = matrix_new(new_rows, mat1->num_cols, matrix_element_size(mat1));
+    if (!stacked) {
+        return NULL; // Handle memory allocation failure
+    }
+
+    if (!matrix_stackv_into(stacked, mat1, mat2)) {
+        matrix_free(stacked);
+        return NULL;
+    }
+    return stacked;
+}
+
+matrix *matrix_stackh_into(matrix *dst, const matrix *mat1, const matrix *mat2) {
+    if (dst == NULL || mat1 == NULL || mat2 == NULL) {
+        return NULL; // Handle null matrices
+    }
+
+    // Check if both matrices have the same number of rows
+    if (mat1->num_rows != mat2->num_rows) {
+        fprintf(stderr, "Error: Matrices must have the same number of rows to stack horizontally.\n");
+        return NULL;
+    }
+    if (dst->num_rows != mat1->num_rows || dst->num_cols != mat1->num_cols + mat2->num_cols) {
+        fprintf(stderr, "Error: Output matrix has the wrong dimensions for the stacked matrices.\n");
+        return NULL;
+    }
+    if (matrix_overlaps(dst, mat1) || matrix_overlaps(dst, mat2)) {
+        fprintf(stderr, "Error: Output matrix must not overlap the matrices being stacked.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat1) || !same_dtype(dst, mat2)) {
+        return NULL;
+    }
+
+    // Copy data from mat1 and mat2 into dst
+    size_t element_size = matrix_element_size(dst);
+    for (size_t i = 0; i < mat1->num_rows; ++i) {
+        // Copy data from mat1
+        memcpy(row_bytes(dst, i), row_bytes(mat1, i), mat1->num_cols * element_size);
+
+        // Copy data from mat2
+        memcpy(row_bytes(dst, i) + mat1->num_cols * element_size, row_bytes(mat2, i), mat2->num_cols * element_size);
+    }
+
+    return dst;
+}
+
+matrix *matrix_stackh(const matrix *mat1, const matrix *mat2) {
+    if (mat1 == NULL || mat2 == NULL) {
+        return NULL; // Handle null matrices
+    }
+
+    // Check if both matrices have the same number of rows
+    if (mat1->num_rows != mat2->num_rows) {
+        fprintf(stderr, "Error: Matrices must have the same number of rows to stack horizontally.\n");
+        return NULL;
+    }
+
+    // Create a new matrix to store the horizontally stacked matrices
+    size_t new_cols = mat1->num_cols + mat2->num_cols;
+    matrix *stacked = matrix_new(mat1->num_rows, new_cols, matrix_element_size(mat1));
+    if (!stacked) {
+        return NULL; // Handle memory allocation failure
+    }
+
+    if (!matrix_stackh_into(stacked, mat1, mat2)) {
+        matrix_free(stacked);
+        return NULL;
+    }
+    return stacked;
+}
+
+/*Matrix math operations*/
+
+void matrix_row_mult_r(matrix *mat, size_t row, double value) {
+    if (row >= mat->num_rows) {
+        fprintf(stderr, "Row index out of bounds\n");
+        return;
+    }
+
+    for (size_t j = 0; j < mat->num_cols; ++j) {
+        matrix_put_c(mat, row, j, matrix_get_c(mat, row, j) * value);
+    }
+}
+
+void matrix_col_mult_r(matrix *mat, size_t col, double value) {
+    if (col >= mat->num_cols) {
         fprintf(stderr, "Column index out of bounds\n");
+        return;
+    }
+
+    for (size_t i = 0; i < mat->num_rows; ++i) {
+        matrix_put_c(mat, i, col, matrix_get_c(mat, i, col) * value);
+    }
+}
+
+void matrix_mult_r(matrix *mat, double value) {
+    ew_job job = { .op = EW_SCALE, .s = value };
+    ew_run(&job, mat, NULL, NULL);
+}
+
+void matrix_mult_c(matrix *mat, double complex value) {
+    if (mat->dtype != MATRIX_C128) {
+        fprintf(stderr, "matrix_mult_c needs a complex matrix.\n");
+        return;
+    }
+
+    // Spelled out on the (re, im) pairs so the loop vectorizes
+    double vr = creal(value), vi = cimag(value);
+    for (size_t i = 0; i < mat->num_rows; ++i) {
+        double *row = row_reals(mat, i);
+        for (size_t j = 0; j < mat->num_cols; ++j) {
+            double re = row[2 * j], im = row[2 * j + 1];
+            row[2 * j] = vr * re - vi * im;
+            row[2 * j + 1] = vr * im + vi * re;
+        }
+    }
+}
+
+void matrix_row_addrow(matrix *mat, size_t row1_index, size_t row2_index, double factor) {
+    if (mat == NULL) {
+        return; // Handle null matrix
+    }
+
+    // Check if row indices are within the bounds of the matrix
+    if (row1_index >= mat->num_rows || row2_index >= mat->num_rows) {
+        fprintf(stderr, "Error: Your matrix 1 or matrix 2 Row index selection is out of bounds.\n");
+        return;
+    }
+
+    // Perform the row addition with the specified factor
+    for (size_t i = 0; i < mat->num_cols; ++i) {
+        matrix_put_c(mat, row2_index, i, matrix_get_c(mat, row2_index, i) + factor * matrix_get_c(mat, row1_index, i));
+    }
+}
+
+
+matrix *matrix_row_rem(matrix *mat, size_t row) {
+    if (!mat->owns_data) {
+        fprintf(stderr, "Cannot remove a row from a view\n");
+        return mat;
+    }
+    if (row >= mat->num_rows) {
+        fprintf(stderr, "Row index out of bounds\n");
         return mat;
     }
 
-    unsigned int new_cols = mat->num_cols - 1;
-    matrix *new_mat = matrix_new(mat->num_rows, new_cols, sizeof(double));
+    size_t new_rows = mat->num_rows - 1;
+    matrix *new_mat = matrix_new(new_rows, mat->num_cols, matrix_element_size(mat));
     if (!new_mat) {
         return NULL; // Failed to allocate new matrix, return the original
     }
 
-    double *new_data = (double *)new_mat->data;
-    double *old_data = (double *)mat->data;
+    for (size_t i = 0, new_i = 0; i < mat->num_rows; i++) {
+        if (i == row) { 
+            continue; // Skip the row to be removed
+        }
+        memcpy(row_bytes(new_mat, new_i), row_bytes(mat, i), mat->num_cols * matrix_element_size(mat));
+        new_i++;
+    }
+
+    matrix_free(mat); // Free the old matrix
+    return new_mat;   // Return the new matrix
+}
+
 
-    for (unsigned int i = 0; i < mat->num_rows; i++) {
-    	for (unsigned int j = 0, new_j = 0; j < mat->num_cols; j++) {
-        	if (j == col) {
-            	    continue; // Skip the column to be removed
-        	}
-        	new_data[i * new_cols + new_j] = old_data[i * mat->num_cols + j];
-                new_j++;
-    	}
+matrix *matrix_col_rem(matrix *mat, size_t col) {
+    if (!mat->owns_data) {
+        fprintf(stderr, "Cannot remove a column from a view\n");
+        return mat;
+    }
+    if (col >= mat->num_cols) {
+        fprintf(stderr, "Column index out of bounds\n");
+        return mat;
+    }
+
+    size_t new_cols = mat->num_cols - 1;
+    matrix *new_mat = matrix_new(mat->num_rows, new_cols, matrix_element_size(mat));
+    if (!new_mat) {
+        return NULL; // Failed to allocate new matrix, return the original
+    }
+
+    // Copy the columns either side of the removed one
+    size_t element_size = matrix_element_size(mat);
+    for (size_t i = 0; i < mat->num_rows; i++) {
+        char *new_data = row_bytes(new_mat, i);
+        const char *old_data = row_bytes(mat, i);
+        memcpy(new_data, old_data, col * element_size);
+        memcpy(new_data + col * element_size, old_data + (col + 1) * element_size, (new_cols - col) * element_size);
     }
 
     matrix_free(mat); // Free the old matrix
     return new_mat;   // Return the new matrix
 }
 
-void matrix_swap_rows(matrix *mat, unsigned int row1, unsigned int row2) {
+void matrix_swap_rows(matrix *mat, size_t row1, size_t row2) {
     if (!mat || row1 >= mat->num_rows || row2 >= mat->num_rows) {
         // Handle invalid input
         fprintf(stderr, "Invalid input for matrix row swap.\n");
         return;
     }
 
-    double *data = (double *)mat->data;
-    for (unsigned int i = 0; i < mat->num_cols; i++) {
-        double temp = data[row1 * mat->num_cols + i];
-        data[row1 * mat->num_cols + i] = data[row2 * mat->num_cols + i];
-        data[row2 * mat->num_cols + i] = temp;
+    if (mat->dtype == MATRIX_F32) {
+        float *r1 = row_ptr_f32(mat, row1);
+        float *r2 = row_ptr_f32(mat, row2);
+        for (size_t i = 0; i < mat->num_cols; i++) {
+            float temp = r1[i];
+            r1[i] = r2[i];
+            r2[i] = temp;
+        }
+        return;
+    }
+
+    double *r1 = row_reals(mat, row1);
+    double *r2 = row_reals(mat, row2);
+    for (size_t i = 0; i < row_width(mat); i++) {
+        double temp = r1[i];
+        r1[i] = r2[i];
+        r2[i] = temp;
     }
 
 }
 
-void matrix_swap_cols(matrix *mat, unsigned int col1, unsigned int col2) {
+void matrix_swap_cols(matrix *mat, size_t col1, size_t col2) {
     if (!mat || col1 >= mat->num_cols || col2 >= mat->num_cols) {
         // Handle invalid input
         fprintf(stderr, "Invalid input for matrix column swap.\n");
         return;
     }
 
-    double *data = (double *)mat->data;
-    for (unsigned int i = 0; i < mat->num_rows; i++) {
-        double temp = data[i * mat->num_cols + col1];
-        data[i * mat->num_cols + col1] = data[i * mat->num_cols + col2];
-        data[i * mat->num_cols + col2] = temp;
+    for (size_t i = 0; i < mat->num_rows; i++) {
+        double complex temp = matrix_get_c(mat, i, col1);
+        matrix_put_c(mat, i, col1, matrix_get_c(mat, i, col2));
+        matrix_put_c(mat, i, col2, temp);
     }
 
 }
@@ -575,13 +1270,37 @@ double matrix_trace(matrix *mat) {
         return trace;
     }
 
-    for (unsigned int i = 0; i < mat->num_rows; i++) {
-        trace += *((double*)mat->data + i * mat->num_cols + i);
+    for (size_t i = 0; i < mat->num_rows; i++) {
+        trace += matrix_get(mat, i, i);
     }
 
     return trace;
 }
 
+// dst = mat1 + sign * mat2; dst may be either operand
+static matrix *add_scaled_into(matrix *dst, const matrix *mat1, const matrix *mat2, double sign) {
+    // Check if all three matrices have the same dimensions
+    if (!dst || !matrix_eqdim(mat1, mat2) || !matrix_eqdim(dst, mat1)) {
+        fprintf(stderr, "Matrices dimensions do not match.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat1) || !same_dtype(dst, mat2)) {
+        return NULL;
+    }
+
+    ew_job job = { .op = EW_ADD, .s = sign };
+    ew_run(&job, dst, mat1, mat2);
+    return dst;
+}
+
+matrix *matrix_add_into(matrix *dst, const matrix *mat1, const matrix *mat2) {
+    return add_scaled_into(dst, mat1, mat2, 1.0);
+}
+
+matrix *matrix_subtract_into(matrix *dst, const matrix *mat1, const matrix *mat2) {
+    return add_scaled_into(dst, mat1, mat2, -1.0);
+}
+
 matrix *matrix_add(const matrix *mat1, const matrix *mat2) {
     // Check if both matrices have the same dimensions
     if (!matrix_eqdim(mat1, mat2)) {
@@ -590,22 +1309,15 @@ matrix *matrix_add(const matrix *mat1, const matrix *mat2) {
     }
 
     // Create a new matrix to store the result
-    matrix *result = matrix_new(mat1->num_rows, mat1->num_cols, sizeof(double));
+    matrix *result = matrix_new(mat1->num_rows, mat1->num_cols, matrix_element_size(mat1));
     if (!result) {
         return NULL; // Memory allocation failure
     }
 
-    // Perform the addition
-    double *data1 = (double *)mat1->data;
-    double *data2 = (double *)mat2->data;
-    double *result_data = (double *)result->data;
-
-    for (unsigned int i = 0; i < mat1->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat1->num_cols; ++j) {
-            result_data[i * mat1->num_cols + j] = data1[i * mat1->num_cols + j] + data2[i * mat1->num_cols + j];
-        }
+    if (!matrix_add_into(result, mat1, mat2)) {
+        matrix_free(result);
+        return NULL;
     }
-
     return result;
 }
 
@@ -617,78 +1329,257 @@ matrix *matrix_subtract(const matrix *mat1, const matrix *mat2) {
     }
 
     // Create a new matrix to store the result
-    matrix *result = matrix_new(mat1->num_rows, mat1->num_cols, sizeof(double));
+    matrix *result = matrix_new(mat1->num_rows, mat1->num_cols, matrix_element_size(mat1));
     if (!result) {
         return NULL; // Memory allocation failure
     }
 
-    // Perform the addition
-    double *data1 = (double *)mat1->data;
-    double *data2 = (double *)mat2->data;
-    double *result_data = (double *)result->data;
+    if (!matrix_subtract_into(result, mat1, mat2)) {
+        matrix_free(result);
+        return NULL;
+    }
+    return result;
+}
 
-    for (unsigned int i = 0; i < mat1->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat1->num_cols; ++j) {
-            result_data[i * mat1->num_cols + j] = data1[i * mat1->num_cols + j] - data2[i * mat1->num_cols + j];
-        }
+// Rows and columns of op(mat)
+static size_t op_rows(const matrix *mat, matrix_op op) {
+    return (op == MATRIX_OP_NONE) ? mat->num_rows : mat->num_cols;
+}
+
+static size_t op_cols(const matrix *mat, matrix_op op) {
+    return (op == MATRIX_OP_NONE) ? mat->num_cols : mat->num_rows;
+}
+
+matrix *matrix_gemm_op_into(matrix *dst, double alpha, const matrix *mat1, matrix_op op1,
+                            const matrix *mat2, matrix_op op2, double beta) {
+    if (!dst || !mat1 || !mat2) {
+        return NULL;
     }
 
-    return result;
+    // Check if the number of columns in op1(mat1) equals the number of rows in op2(mat2)
+    size_t m = op_rows(mat1, op1), n = op_cols(mat2, op2), k = op_cols(mat1, op1);
+    if (k != op_rows(mat2, op2)) {
+        fprintf(stderr, "Matrix dimensions are not compatible for multiplication.\n");
+        return NULL;
+    }
+    if (dst->num_rows != m || dst->num_cols != n) {
+        fprintf(stderr, "Output matrix must be %zu x %zu for this product.\n", m, n);
+        return NULL;
+    }
+
+    // The packed kernels read A and B while C is being written, so C may not alias them
+    if (matrix_overlaps(dst, mat1) || matrix_overlaps(dst, mat2)) {
+        fprintf(stderr, "Output matrix must not overlap the matrices being multiplied.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat1) || !same_dtype(dst, mat2)) {
+        return NULL;
+    }
+
+    // Perform matrix multiplication with the packed, cache-blocked GEMM engine; the
+    // transposes are taken while the operands are packed
+    bool trans1 = (op1 != MATRIX_OP_NONE), trans2 = (op2 != MATRIX_OP_NONE);
+    if (dst->dtype == MATRIX_C128) {
+        matrix_zgemm(op1, op2, m, n, k, alpha,
+                     mat1->data, mat1->stride, mat2->data, mat2->stride,
+                     beta, dst->data, dst->stride);
+    } else if (dst->dtype == MATRIX_F32) {
+        matrix_sgemm(trans1, trans2, m, n, k, (float)alpha,
+                     (const float *)mat1->data, mat1->stride,
+                     (const float *)mat2->data, mat2->stride,
+                     (float)beta, (float *)dst->data, dst->stride);
+    } else {
+        matrix_dgemm(trans1, trans2, m, n, k, alpha,
+                     (const double *)mat1->data, mat1->stride,
+                     (const double *)mat2->data, mat2->stride,
+                     beta, (double *)dst->data, dst->stride);
+    }
+
+    return dst;
 }
 
+matrix *matrix_gemm_into(matrix *dst, double alpha, const matrix *mat1, const matrix *mat2, double beta) {
+    return matrix_gemm_op_into(dst, alpha, mat1, MATRIX_OP_NONE, mat2, MATRIX_OP_NONE, beta);
+}
 
-matrix *matrix_mult(const matrix *mat1, const matrix *mat2) {
-    // Check if the number of columns in mat1 equals the number of rows in mat2
-    if (mat1->num_cols != mat2->num_rows) {
+matrix *matrix_mult_into(matrix *dst, const matrix *mat1, const matrix *mat2) {
+    return matrix_gemm_into(dst, 1.0, mat1, mat2, 0.0);
+}
+
+matrix *matrix_mult_op(const matrix *mat1, matrix_op op1, const matrix *mat2, matrix_op op2) {
+    // Check if the number of columns in op1(mat1) equals the number of rows in op2(mat2)
+    if (op_cols(mat1, op1) != op_rows(mat2, op2)) {
         fprintf(stderr, "Matrix dimensions are not compatible for multiplication.\n");
         return NULL;
     }
 
     // Create a new matrix to store the result
-    matrix *result = matrix_new(mat1->num_rows, mat2->num_cols, sizeof(double));
+    matrix *result = matrix_new(op_rows(mat1, op1), op_cols(mat2, op2), matrix_element_size(mat1));
     if (!result) {
         return NULL; // Memory allocation failure
     }
 
-    // Perform matrix multiplication
-    double *data1 = (double *)mat1->data;
-    double *data2 = (double *)mat2->data;
-    double *result_data = (double *)result->data;
+    if (!matrix_gemm_op_into(result, 1.0, mat1, op1, mat2, op2, 0.0)) {
+        matrix_free(result);
+        return NULL;
+    }
+    return result;
+}
 
-    for (unsigned int i = 0; i < mat1->num_rows; ++i) {
-        for (unsigned int j = 0; j < mat2->num_cols; ++j) {
-            double sum = 0.0;
-            for (unsigned int k = 0; k < mat1->num_cols; ++k) {
-                sum += data1[i * mat1->num_cols + k] * data2[k * mat2->num_cols + j];
-            }
-            result_data[i * mat2->num_cols + j] = sum;
-        }
+matrix *matrix_mult(const matrix *mat1, const matrix *mat2) {
+    return matrix_mult_op(mat1, MATRIX_OP_NONE, mat2, MATRIX_OP_NONE);
+}
+
+// Copies the uplo triangle of the square mat over the other one
+static void symmetrize(matrix *mat, matrix_uplo uplo) {
+    bool lower = (uplo == MATRIX_LOWER);
+    if (mat->dtype == MATRIX_F32) {
+        matrix_ssymmetrize(lower, mat->num_rows, mat->data, mat->stride);
+    } else {
+        matrix_dsymmetrize(lower, mat->num_rows, mat->data, mat->stride);
+    }
+}
+
+matrix *matrix_syrk_into(matrix *dst, double alpha, const matrix *mat, matrix_op op, double beta,
+                         matrix_uplo uplo, bool mirror) {
+    if (!dst || !mat) {
+        return NULL;
+    }
+    if (mat->dtype == MATRIX_C128) {
+        fprintf(stderr, "Symmetric rank-k update needs a real matrix.\n");
+        return NULL;
+    }
+
+    // op(mat) is n x k and the result n x n
+    size_t n = op_rows(mat, op), k = op_cols(mat, op);
+    if (dst->num_rows != n || dst->num_cols != n) {
+        fprintf(stderr, "Output matrix must be %zu x %zu for this product.\n", n, n);
+        return NULL;
+    }
+    if (matrix_overlaps(dst, mat)) {
+        fprintf(stderr, "Output matrix must not overlap the matrix being multiplied.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat)) {
+        return NULL;
+    }
+
+    bool lower = (uplo == MATRIX_LOWER), trans = (op != MATRIX_OP_NONE);
+    int info;
+    if (dst->dtype == MATRIX_F32) {
+        info = matrix_ssyrk(lower, trans, n, k, (float)alpha, mat->data, mat->stride,
+                            (float)beta, dst->data, dst->stride);
+    } else {
+        info = matrix_dsyrk(lower, trans, n, k, alpha, mat->data, mat->stride,
+                            beta, dst->data, dst->stride);
+    }
+    if (info != 0) {
+        return NULL;
+    }
+
+    if (mirror) {
+        symmetrize(dst, uplo);
+    }
+    return dst;
+}
+
+matrix *matrix_syrk(const matrix *mat, matrix_op op) {
+    if (!mat) {
+        return NULL;
+    }
+
+    // Create a new matrix to store the result
+    size_t n = op_rows(mat, op);
+    matrix *result = matrix_new(n, n, matrix_element_size(mat));
+    if (!result) {
+        return NULL; // Memory allocation failure
+    }
+
+    if (!matrix_syrk_into(result, 1.0, mat, op, 0.0, MATRIX_LOWER, true)) {
+        matrix_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+matrix *matrix_symm_into(matrix *dst, double alpha, const matrix *sym, matrix_uplo uplo,
+                         const matrix *mat, double beta) {
+    if (!dst || !sym || !mat) {
+        return NULL;
+    }
+    if (sym->dtype == MATRIX_C128) {
+        fprintf(stderr, "Symmetric multiply needs a real matrix.\n");
+        return NULL;
+    }
+    if (!sym->is_square || sym->num_cols != mat->num_rows) {
+        fprintf(stderr, "Matrix dimensions are not compatible for multiplication.\n");
+        return NULL;
+    }
+    if (dst->num_rows != mat->num_rows || dst->num_cols != mat->num_cols) {
+        fprintf(stderr, "Output matrix must be %zu x %zu for this product.\n", mat->num_rows, mat->num_cols);
+        return NULL;
+    }
+    if (matrix_overlaps(dst, sym) || matrix_overlaps(dst, mat)) {
+        fprintf(stderr, "Output matrix must not overlap the matrices being multiplied.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, sym) || !same_dtype(dst, mat)) {
+        return NULL;
+    }
+
+    bool lower = (uplo == MATRIX_LOWER);
+    size_t m = mat->num_rows, n = mat->num_cols;
+    int info;
+    if (dst->dtype == MATRIX_F32) {
+        info = matrix_ssymm(lower, m, n, (float)alpha, sym->data, sym->stride, mat->data, mat->stride,
+                            (float)beta, dst->data, dst->stride);
+    } else {
+        info = matrix_dsymm(lower, m, n, alpha, sym->data, sym->stride, mat->data, mat->stride,
+                            beta, dst->data, dst->stride);
+    }
+    return (info == 0) ? dst : NULL;
+}
+
+matrix *matrix_symm(const matrix *sym, matrix_uplo uplo, const matrix *mat) {
+    if (!sym || !mat) {
+        return NULL;
+    }
+
+    // Create a new matrix to store the result
+    matrix *result = matrix_new(mat->num_rows, mat->num_cols, matrix_element_size(mat));
+    if (!result) {
+        return NULL; // Memory allocation failure
     }
 
+    if (!matrix_symm_into(result, 1.0, sym, uplo, mat, 0.0)) {
+        matrix_free(result);
+        return NULL;
+    }
     return result;
 }
 
 
-int matrix_pivotidx(matrix *mat, unsigned int col, unsigned int row) {
-    int i, maxi;
+int64_t matrix_pivotidx(matrix *mat, size_t col, size_t row) {
+    size_t i, maxi;
     double maxcol;
-    double max = fabs(matrix_at(mat, row, col));
+    matrix_at(mat, row, col); // matrix_at validates the caller's row and col
+    double max = cabs(matrix_get_c(mat, row, col));
     maxi = row;
-    for (i = row; i <(int)(mat->num_rows); i++) {
-        maxcol = fabs(matrix_at(mat, i, col));
+    for (i = row; i < mat->num_rows; i++) {
+        maxcol = cabs(matrix_get_c(mat, i, col));
         if (maxcol > max) {
             max = maxcol;
             maxi = i;
         }
     }
-    return (max < 1e-10) ? -1 : maxi; // You can adjust the tolerance as needed
+    return (max < 1e-10) ? -1 : (int64_t)maxi; // You can adjust the tolerance as needed
 }
 
 
 matrix *matrix_ref(matrix *mat) {
     matrix *result = matrix_copy(mat);
-    unsigned int i, j, k;
-    int pivot;
+    size_t i, j, k;
+    int64_t pivot;
     j = 0, i = 0;
 
     while (j < result->num_cols && i < result->num_cols) {
@@ -703,18 +1594,22 @@ matrix *matrix_ref(matrix *mat) {
         }
 
         // Interchange rows, moving the pivot to the first row that doesn't have a pivot
-        if (pivot != (int)i) {
+        if (pivot != (int64_t)i) {
             matrix_swap_rows(result, i, pivot);
         }
 
         // Multiply each element in the pivot row by the inverse of the pivot
-        double pivot_value = matrix_at(result, i, j);
-        matrix_row_mult_r(result, i, 1.0 / pivot_value);
+        double complex pivot_inv = 1.0 / matrix_get_c(result, i, j);
+        for (size_t c = 0; c < result->num_cols; c++) {
+            matrix_put_c(result, i, c, matrix_get_c(result, i, c) * pivot_inv);
+        }
 
         // Add multiples of the pivot row to make every element in the column below the pivot equal to 0
         for (k = i + 1; k < result->num_rows; k++) {
-            double factor = -matrix_at(result, k, j);
-            matrix_row_addrow(result, i, k, factor);
+            double complex factor = matrix_get_c(result, k, j);
+            for (size_t c = 0; c < result->num_cols; c++) {
+                matrix_put_c(result, k, c, matrix_get_c(result, k, c) - factor * matrix_get_c(result, i, c));
+            }
         }
 
         i++;
@@ -724,22 +1619,149 @@ matrix *matrix_ref(matrix *mat) {
     return result;
 }
 
+// The blocked kernels for a square matrix's element type; see matrix_internal.h
+
+static int getrf(matrix *A, size_t *ipiv) {
+    if (A->dtype == MATRIX_C128) {
+        return matrix_zgetrf(A->num_rows, A->data, A->stride, ipiv);
+    }
+    if (A->dtype == MATRIX_F32) {
+        return matrix_sgetrf(A->num_rows, A->data, A->stride, ipiv);
+    }
+    return matrix_dgetrf(A->num_rows, A->data, A->stride, ipiv);
+}
+
+static int getri(matrix *A, const size_t *ipiv) {
+    if (A->dtype == MATRIX_C128) {
+        return matrix_zgetri(A->num_rows, A->data, A->stride, ipiv);
+    }
+    if (A->dtype == MATRIX_F32) {
+        return matrix_sgetri(A->num_rows, A->data, A->stride, ipiv);
+    }
+    return matrix_dgetri(A->num_rows, A->data, A->stride, ipiv);
+}
+
+static int potrf(matrix *A) {
+    if (A->dtype == MATRIX_F32) {
+        return matrix_spotrf(A->num_rows, A->data, A->stride);
+    }
+    return matrix_dpotrf(A->num_rows, A->data, A->stride);
+}
+
+static int potri(matrix *A) {
+    if (A->dtype == MATRIX_F32) {
+        return matrix_spotri(A->num_rows, A->data, A->stride);
+    }
+    return matrix_dpotri(A->num_rows, A->data, A->stride);
+}
+
+// Solves op(T) X = B in place, T and B of one element type; complex T is never transposed
+static void trsm_left(const matrix *T, bool lower, bool trans, bool unit_diag, matrix *B) {
+    if (T->dtype == MATRIX_C128) {
+        matrix_ztrsm_left(lower, unit_diag, T->num_rows, B->num_cols, T->data, T->stride, B->data, B->stride);
+    } else if (T->dtype == MATRIX_F32) {
+        matrix_strsm_left(lower, trans, unit_diag, T->num_rows, B->num_cols, T->data, T->stride, B->data, B->stride);
+    } else {
+        matrix_dtrsm_left(lower, trans, unit_diag, T->num_rows, B->num_cols, T->data, T->stride, B->data, B->stride);
+    }
+}
+
 void matrix_lup_free(matrix_lup *lu) {
     matrix_free(lu->P);
     matrix_free(lu->L);
     matrix_free(lu->U);
-    free(lu);
+    if (lu->owns_LU) {
+        matrix_free(lu->LU);
+    }
+    matrix_mem_free(lu->pivots);
+    matrix_mem_free(lu);
 }
 
+// Turns a dense permutation matrix into the equivalent sequence of row swaps
+static size_t *lup_pivots_from_P(const matrix *P, size_t n) {
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    size_t *pivots = matrix_mem_alloc(n * sizeof(size_t));
+    size_t *row_at = matrix_scratch_alloc(mark, n * sizeof(size_t)); // original row currently at each position
+    size_t *pos_of = matrix_scratch_alloc(mark, n * sizeof(size_t)); // position of each original row
+    if (!pivots || !row_at || !pos_of) {
+        matrix_mem_free(pivots);
+        matrix_scratch_end(mark);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        row_at[i] = i;
+        pos_of[i] = i;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (!P) {
+            pivots[i] = i;
+            continue;
+        }
+
+        // Row i of P * A is the row of A where P has its 1
+        size_t src = n;
+        for (size_t j = 0; j < n; j++) {
+            if (matrix_get(P, i, j) == 1.0) {
+                src = j;
+                break;
+            }
+        }
+        if (src == n || pos_of[src] < i) {
+            matrix_mem_free(pivots);
+            pivots = NULL;
+            break;
+        }
+
+        size_t p = pos_of[src];
+        pivots[i] = p;
+        row_at[p] = row_at[i];
+        pos_of[row_at[p]] = p;
+        row_at[i] = src;
+        pos_of[src] = i;
+    }
+
+    matrix_scratch_end(mark);
+    return pivots;
+}
 
 // Function to create a new LUP decomposition
-matrix_lup *matrix_lup_new(matrix *L, matrix *U, matrix *P, unsigned int num_permutations) {
-    matrix_lup *lup = malloc(sizeof(matrix_lup));
+matrix_lup *matrix_lup_new(matrix *L, matrix *U, matrix *P, size_t num_permutations) {
+    matrix_lup *lup = matrix_mem_alloc(sizeof(matrix_lup));
     if (!lup) {
         fprintf(stderr, "Failed to allocate memory for LUP decomposition.\n");
         return NULL;
     }
 
+    lup->pivots = NULL;
+    lup->LU = NULL;
+    lup->owns_LU = true;
+    if (L && U) {
+        if (!same_dtype(L, U)) {
+            matrix_mem_free(lup);
+            return NULL;
+        }
+        lup->pivots = lup_pivots_from_P(P, U->num_rows);
+        if (!lup->pivots) {
+            fprintf(stderr, "P must be a permutation matrix for LUP decomposition.\n");
+            matrix_mem_free(lup);
+            return NULL;
+        }
+
+        // Pack L's multipliers and U into the single buffer the solvers read
+        lup->LU = matrix_copy(U);
+        if (!lup->LU) {
+            matrix_mem_free(lup->pivots);
+            matrix_mem_free(lup);
+            return NULL;
+        }
+        const matrix *LU = lup->LU;
+        for (size_t i = 1; i < U->num_rows; i++) {
+            memcpy(row_bytes(LU, i), row_bytes(L, i), i * matrix_element_size(LU));
+        }
+    }
+
     lup->L = L;
     lup->U = U;
     lup->P = P;
@@ -748,64 +1770,146 @@ matrix_lup *matrix_lup_new(matrix *L, matrix *U, matrix *P, unsigned int num_per
     return lup;
 }
 
-// Function to perform LUP decomposition on a matrix
-matrix_lup *matrix_lup_solve(matrix *m) {
-    if (!m->is_square) {
-        fprintf(stderr, "Matrix must be square for LUP decomposition.\n");
-        return NULL;
+// Builds the dense unit lower factor from the packed one the first time it is asked for
+matrix *matrix_lup_L(matrix_lup *lu) {
+    if (!lu || !lu->LU) {
+        return lu ? lu->L : NULL;
     }
 
-    // Create matrices for L, U, and P
-    double identity_element = 1.0;
-    matrix *L = matrix_eye(m->num_rows, sizeof(double), &identity_element);
-    matrix *U = matrix_copy(m);
-    matrix *P = matrix_eye(m->num_rows, sizeof(double), &identity_element);
+    if (!lu->L) {
+        size_t n = lu->LU->num_rows;
+        matrix *L = matrix_new(n, n, matrix_element_size(lu->LU));
+        if (!L) {
+            return NULL;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            memcpy(row_bytes(L, i), row_bytes(lu->LU, i), i * matrix_element_size(L));
+            matrix_put(L, i, i, 1.0);
+        }
+        lu->L = L;
+    }
+    return lu->L;
+}
 
-    unsigned int num_permutations = 0;
-    double mult;
+// Builds the dense upper factor from the packed one the first time it is asked for
+matrix *matrix_lup_U(matrix_lup *lu) {
+    if (!lu || !lu->LU) {
+        return lu ? lu->U : NULL;
+    }
 
-    for (unsigned int j = 0; j < U->num_cols; j++) {
-        // Find the pivot (maximum absolute value) in the current column
-        unsigned int pivot = j;
-        for (unsigned int i = j + 1; i < U->num_rows; i++) {
-            if (fabs(matrix_at(U, i, j)) > fabs(matrix_at(U, pivot, j))) {
-                pivot = i;
-            }
+    if (!lu->U) {
+        size_t n = lu->LU->num_rows;
+        matrix *U = matrix_copy(lu->LU);
+        if (!U) {
+            return NULL;
         }
+        for (size_t i = 1; i < n; i++) {
+            memset(row_bytes(U, i), 0, i * matrix_element_size(U));
+        }
+        lu->U = U;
+    }
+    return lu->U;
+}
 
-        if (fabs(matrix_at(U, pivot, j)) < 1e-10) {
-            fprintf(stderr, "Matrix is degenerate, LUP decomposition failed.\n");
-            matrix_free(L);
-            matrix_free(U);
-            matrix_free(P);
+// Builds the dense permutation matrix from the pivots the first time it is asked for
+matrix *matrix_lup_P(matrix_lup *lu) {
+    if (!lu || !lu->LU) {
+        return NULL;
+    }
+
+    if (!lu->P) {
+        size_t n = lu->LU->num_rows;
+        matrix *P = matrix_new(n, n, matrix_element_size(lu->LU));
+        if (!P) {
             return NULL;
         }
+        matrix_diag_set(P, &(double){1.0}, sizeof(double));
+        matrix_lup_permute(lu, P);
+        lu->P = P;
+    }
+    return lu->P;
+}
 
-        if (pivot != j) {
-            // Swap rows in U, L, and P to move the pivot to the current row
-            matrix_swap_rows(U, j, pivot);
-            matrix_swap_rows(L, j, pivot);
-            matrix_swap_rows(P, j, pivot);
-            num_permutations++;
+// Applies the row permutation P to b in place, O(n) swaps instead of an O(n^2) product
+void matrix_lup_permute(const matrix_lup *lu, matrix *b) {
+    if (!lu || !lu->pivots || !b || b->num_rows != lu->LU->num_rows) {
+        fprintf(stderr, "Invalid input for LUP permutation.\n");
+        return;
+    }
+
+    for (size_t i = 0; i < b->num_rows; i++) {
+        if (lu->pivots[i] != i) {
+            matrix_swap_rows(b, i, lu->pivots[i]);
+        }
+    }
+}
+
+// Function to perform LUP decomposition into a single packed buffer, LAPACK style.
+// With in_place the caller's matrix is overwritten by the factors and no copy is made.
+matrix_lup *matrix_lup_factor(matrix *m, bool in_place) {
+    if (!m || !m->is_square) {
+        fprintf(stderr, "Matrix must be square for LUP decomposition.\n");
+        return NULL;
+    }
+
+    size_t n = m->num_rows;
+
+    matrix *LU = in_place ? m : matrix_copy(m);
+    size_t *ipiv = matrix_mem_alloc(n * sizeof(size_t));
+    matrix_lup *lup = matrix_mem_alloc(sizeof(matrix_lup));
+    if (!LU || !ipiv || !lup) {
+        if (!in_place) {
+            matrix_free(LU);
         }
+        matrix_mem_free(ipiv);
+        matrix_mem_free(lup);
+        return NULL;
+    }
 
-        for (unsigned int i = j + 1; i < U->num_rows; i++) {
-            mult = matrix_at(U, i, j) / matrix_at(U, j, j);
-            // Update U and store the multiplier in L
-            matrix_row_addrow(U, j, i, -mult);
-            matrix_set(L, i, j, mult);
+    if (getrf(LU, ipiv) != 0) {
+        fprintf(stderr, "Matrix is degenerate, LUP decomposition failed.\n");
+        if (!in_place) {
+            matrix_free(LU);
         }
+        matrix_mem_free(ipiv);
+        matrix_mem_free(lup);
+        return NULL;
     }
 
-    double val = 1.0;
-    matrix_diag_set(L, &val, sizeof(double));
+    size_t num_permutations = 0;
+    for (size_t j = 0; j < n; j++) {
+        if (ipiv[j] != j) {
+            num_permutations++;
+        }
+    }
 
-    // Create the LUP decomposition
-    matrix_lup *lup = matrix_lup_new(L, U, P, num_permutations);
+    lup->L = NULL;
+    lup->U = NULL;
+    lup->P = NULL;
+    lup->LU = LU;
+    lup->owns_LU = !in_place;
+    lup->pivots = ipiv;
+    lup->num_permutations = num_permutations;
     return lup;
 }
 
-// Function to perform forward substitution to solve the linear system L * x = b
+// Function to perform LUP decomposition on a matrix, with L and U also as dense matrices
+matrix_lup *matrix_lup_solve(matrix *m) {
+    matrix_lup *lup = matrix_lup_factor(m, false);
+    if (!lup) {
+        return NULL;
+    }
+
+    if (!matrix_lup_L(lup) || !matrix_lup_U(lup)) {
+        matrix_lup_free(lup);
+        return NULL;
+    }
+    return lup;
+}
+
+// Function to perform forward substitution to solve the linear system L * X = B,
+// where B may hold any number of right-hand-side columns
 matrix *matrix_ls_solvefwd(matrix *L, matrix *b) {
     if (L == NULL || b == NULL) {
         fprintf(stderr, "Invalid input matrices for forward substitution.\n");
@@ -817,134 +1921,199 @@ matrix *matrix_ls_solvefwd(matrix *L, matrix *b) {
         return NULL;
     }
 
-    if (L->num_rows != b->num_rows || b->num_cols != 1) {
+    if (L->num_rows != b->num_rows) {
         fprintf(stderr, "Matrix dimensions are not compatible for forward substitution.\n");
         return NULL;
     }
+    if (!same_dtype(L, b)) {
+        return NULL;
+    }
 
-    unsigned int n = L->num_rows;
-    matrix *x = matrix_new(n, 1, sizeof(double));
-
+    matrix *x = matrix_copy(b);
     if (x == NULL) {
         fprintf(stderr, "Memory allocation failed for the solution vector.\n");
         return NULL;
     }
 
-    // Perform forward substitution
-    for (unsigned int i = 0; i < n; i++) {
-        double sum = 0.0;
-        for (unsigned int j = 0; j < i; j++) {
-            sum += matrix_at(L, i, j) * matrix_at(x, j, 0);
-        }
-        double bi = matrix_at(b, i, 0);
-        double xi = (bi - sum) / matrix_at(L, i, i);
-        matrix_set(x, i, 0, xi);
-    }
-
+    trsm_left(L, true, false, false, x);
     return x;
 }
 
+// Function to perform back substitution to solve the linear system U * X = B,
+// where B may hold any number of right-hand-side columns
 matrix *matrix_ls_solvebck(matrix *U, matrix *b) {
-    matrix *x = matrix_new(U->num_cols, 1, sizeof(double));
-    int i = U->num_cols - 1;
-    int j;
-    double tmp;
-    
-    while (i >= 0) {
-        tmp = ((double *)b->data)[i * b->num_cols + 0];
-        for (j = i + 1; j < (int)(U->num_cols); j++) {
-    	    tmp -= matrix_at(U, i, j) * matrix_at(x, j, 0);
-        }
-	matrix_set(x, i, 0, tmp / matrix_at(U, i, i));
-        i--;
+    if (U == NULL || b == NULL) {
+        fprintf(stderr, "Invalid input matrices for back substitution.\n");
+        return NULL;
     }
-    
+
+    if (U->num_rows != U->num_cols) {
+        fprintf(stderr, "Matrix U must be square for back substitution.\n");
+        return NULL;
+    }
+
+    if (U->num_rows != b->num_rows) {
+        fprintf(stderr, "Matrix dimensions are not compatible for back substitution.\n");
+        return NULL;
+    }
+    if (!same_dtype(U, b)) {
+        return NULL;
+    }
+
+    matrix *x = matrix_copy(b);
+    if (x == NULL) {
+        fprintf(stderr, "Memory allocation failed for the solution vector.\n");
+        return NULL;
+    }
+
+    trsm_left(U, false, false, false, x);
     return x;
 }
 
+// Solves A * X = B for every column of B using the factorization PA = LU
 matrix *matrix_ls_solve(matrix_lup *lu, matrix *b) {
   // Check if dimensions are valid
-  if (lu->U->num_rows != b->num_rows || b->num_cols != 1) {
+  if (lu->LU->num_rows != b->num_rows) {
     fprintf(stderr, "Dimensions of matrix are not valid.\n");
     return NULL;
   }
+  if (!same_dtype(lu->LU, b)) {
+    return NULL;
+  }
 
-  // Calculate Pb = P*b
-  matrix *Pb = matrix_mult(lu->P, b);
-
-  // Solve L*y = Pb using forward substitution
-  matrix *y = matrix_ls_solvefwd(lu->L, Pb);
-
-  // Solve U*x = y using backward substitution
-  matrix *x = matrix_ls_solvebck(lu->U, y);
+  // Calculate PB by replaying the row swaps on a copy of B
+  matrix *x = matrix_copy(b);
+  if (!x) {
+    return NULL;
+  }
+  matrix_lup_permute(lu, x);
 
-  // Free intermediate matrices
-  matrix_free(y);
-  matrix_free(Pb);
+  // Solve L*Y = PB and then U*X = Y in place, reading both factors from the packed LU
+  trsm_left(lu->LU, true, false, true, x);
+  trsm_left(lu->LU, false, false, false, x);
 
   return x;
 }
 
 
-matrix *matrix_inv(matrix *mat) {
-    if (!mat->is_square) {
+// Computes the inverse into dst (LAPACK getri style): dst is factored in place and then
+// overwritten by the inverse, so no temporaries beyond the pivots and one panel buffer
+matrix *matrix_inv_into(matrix *dst, const matrix *mat) {
+    if (!dst || !mat || !mat->is_square) {
         fprintf(stderr, "Matrix must be square for inversion.\n");
         return NULL;
     }
 
-    // Perform LU decomposition
-    matrix_lup *lu = matrix_lup_solve(mat);
+    if (!matrix_eqdim(dst, mat)) {
+        fprintf(stderr, "Output matrix must have the same dimensions as the matrix to invert.\n");
+        return NULL;
+    }
+    if (!same_dtype(dst, mat)) {
+        return NULL;
+    }
+
+    size_t n = mat->num_rows;
+    if (dst != mat) {
+        copy_rows(dst, mat);
+    }
 
-    if (!lu) {
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    size_t *ipiv = matrix_scratch_alloc(mark, n * sizeof(size_t));
+    if (!ipiv) {
+        matrix_scratch_end(mark);
+        return NULL;
+    }
+
+    if (getrf(dst, ipiv) != 0 || getri(dst, ipiv) != 0) {
         fprintf(stderr, "LU decomposition failed. The matrix might be singular.\n");
+        matrix_scratch_end(mark);
         return NULL;
     }
 
-    // Create an identity matrix of the same size as the input matrix
-    double identity_element = 1.0;
-    matrix *identity = matrix_eye(mat->num_rows, sizeof(double), &identity_element);
+    matrix_scratch_end(mark);
+    return dst;
+}
 
-    // Initialize the inverse matrix
-    matrix *inverse = matrix_new(mat->num_rows, mat->num_cols, sizeof(double));
+// Computes the inverse from an existing LUP decomposition, into dst or a new matrix if dst is NULL
+matrix *matrix_lup_inv(const matrix_lup *lu, matrix *dst) {
+    if (!lu || !lu->LU || !lu->pivots) {
+        fprintf(stderr, "Invalid LUP decomposition for inversion.\n");
+        return NULL;
+    }
 
-    // Solve for the inverse by applying LU decomposition to each column of the identity matrix
-    Range all_rows = {-1, -1};
-    for (unsigned int col = 0; col < mat->num_cols; col++) {
-        Range col_range = {col, col + 1};
-        matrix *b = matrix_slice(identity, all_rows, col_range);  // Take single col from identity matrix
-        matrix *x = matrix_ls_solve(lu, b);  // Solve for the column of the inverse
+    size_t n = lu->LU->num_rows;
+    bool owns_dst = (dst == NULL);
+    if (owns_dst) {
+        dst = matrix_new(n, n, matrix_element_size(lu->LU));
+        if (!dst) {
+            return NULL;
+        }
+    } else if (!matrix_eqdim(dst, lu->LU)) {
+        fprintf(stderr, "Output matrix must have the same dimensions as the factored matrix.\n");
+        return NULL;
+    } else if (!same_dtype(dst, lu->LU)) {
+        return NULL;
+    }
 
-        // Copy the solution (x) to the corresponding column of the inverse matrix
-        for (unsigned int row = 0; row < mat->num_rows; row++) {
-            matrix_set(inverse, row, col, matrix_at(x, row, 0));
+    if (dst != lu->LU) {
+        copy_rows(dst, lu->LU);
+    }
+    if (getri(dst, lu->pivots) != 0) {
+        fprintf(stderr, "Matrix is singular and cannot be inverted.\n");
+        if (owns_dst) {
+            matrix_free(dst);
         }
+        return NULL;
+    }
+    return dst;
+}
 
-        // Free the temporary matrices
-        matrix_free(b);
-        matrix_free(x);
+matrix *matrix_inv(matrix *mat) {
+    if (!mat->is_square) {
+        fprintf(stderr, "Matrix must be square for inversion.\n");
+        return NULL;
     }
 
-    // Free the LU decomposition and intermediate matrices
-    matrix_lup_free(lu);
-    matrix_free(identity);
+    matrix *inverse = matrix_new(mat->num_rows, mat->num_cols, matrix_element_size(mat));
+    if (!inverse) {
+        return NULL;
+    }
 
+    if (!matrix_inv_into(inverse, mat)) {
+        matrix_free(inverse);
+        return NULL;
+    }
     return inverse;
-
 }
 
 double matrix_det(matrix_lup *lup) {
-    int k;
+    if (lup->LU && lup->LU->dtype == MATRIX_C128) {
+        return creal(matrix_det_c(lup));
+    }
+
+    size_t k;
     int sign = (lup->num_permutations % 2 == 0) ? 1 : -1;
-    matrix *U = lup->U;
+    matrix *U = lup->LU; // U's diagonal is the packed diagonal
     double product = 1.0;
 
-    for(k = 0; k < (int)(U->num_rows); k++) {
-        product *= matrix_at(U, k, k);
+    for(k = 0; k < U->num_rows; k++) {
+        product *= matrix_get(U, k, k);
     }
     return product * sign;
 
 }
 
+double complex matrix_det_c(matrix_lup *lup) {
+    int sign = (lup->num_permutations % 2 == 0) ? 1 : -1;
+    const matrix *U = lup->LU;
+    double complex product = 1.0;
+
+    for (size_t k = 0; k < U->num_rows; k++) {
+        product *= matrix_get_c(U, k, k);
+    }
+    return product * sign;
+}
+
 // Function to perform Cholesky decomposition
 matrix_lup *matrix_cholesky_solve(matrix *mat) {
     // Check if the input matrix is square and symmetric
@@ -953,42 +2122,157 @@ matrix_lup *matrix_cholesky_solve(matrix *mat) {
         return NULL;
     }
 
-    unsigned int n = mat->num_rows;
-    matrix *L = matrix_new(n, n, sizeof(double));
-
-    for (unsigned int i = 0; i < n; i++) {
-        for (unsigned int j = 0; j <= i; j++) {
-            double sum = 0.0;
-            if (j == i) {
-                for (unsigned int k = 0; k < j; k++) {
-                    double L_kk = matrix_at(L, j, k);
-                    sum += L_kk * L_kk;
-                }
-                double L_ii = sqrt(matrix_at(mat, i, i) - sum);
-                matrix_set(L, i, i, L_ii);
-            } else {
-                for (unsigned int k = 0; k < j; k++) {
-                    sum += matrix_at(L, i, k) * matrix_at(L, j, k);
-                }
-                double L_ij = (matrix_at(mat, i, j) - sum) / matrix_at(L, j, j);
-                matrix_set(L, i, j, L_ij);
-            }
-        }
+    matrix_cholesky *chol = matrix_cholesky_factor(mat, false);
+    if (!chol) {
+        return NULL;
     }
 
-    matrix_lup *cholesky = (matrix_lup *)malloc(sizeof(matrix_lup));
-    cholesky->L = L;
+    matrix_lup *cholesky = matrix_mem_alloc(sizeof(matrix_lup));
+    if (!cholesky) {
+        matrix_cholesky_factor_free(chol);
+        return NULL;
+    }
+    cholesky->L = chol->L;
     cholesky->U = NULL; // Cholesky decomposition only requires L
     cholesky->P = NULL; // No permutation matrix for Cholesky
+    cholesky->LU = NULL;
+    cholesky->owns_LU = false;
+    cholesky->pivots = NULL;
     cholesky->num_permutations = 0;
+    matrix_mem_free(chol);
 
     return cholesky;
 }
 
+// Function to perform a blocked Cholesky decomposition A = L * L^T. Only the lower
+// triangle of m is read. With in_place the factor overwrites m's lower triangle and
+// the strict upper triangle is left untouched; otherwise L is a new dense matrix.
+matrix_cholesky *matrix_cholesky_factor(matrix *m, bool in_place) {
+    if (!m || !m->is_square) {
+        fprintf(stderr, "Matrix must be square for Cholesky decomposition.\n");
+        return NULL;
+    }
+    if (m->dtype == MATRIX_C128) {
+        fprintf(stderr, "Cholesky decomposition needs a real matrix.\n");
+        return NULL;
+    }
+
+    size_t n = m->num_rows;
+
+    matrix *L = in_place ? m : matrix_copy(m);
+    matrix_cholesky *chol = matrix_mem_alloc(sizeof(matrix_cholesky));
+    if (!L || !chol) {
+        if (!in_place) {
+            matrix_free(L);
+        }
+        matrix_mem_free(chol);
+        return NULL;
+    }
+
+    int info = potrf(L);
+    if (info != 0) {
+        if (info > 0) {
+            fprintf(stderr, "Matrix is not positive definite, Cholesky decomposition failed.\n");
+        }
+        if (!in_place) {
+            matrix_free(L);
+        }
+        matrix_mem_free(chol);
+        return NULL;
+    }
+
+    if (!in_place) {
+        for (size_t i = 0; i < n; i++) {
+            memset(row_bytes(L, i) + (i + 1) * matrix_element_size(L), 0, (n - i - 1) * matrix_element_size(L));
+        }
+    }
+
+    chol->L = L;
+    chol->owns_L = !in_place;
+    return chol;
+}
+
+void matrix_cholesky_factor_free(matrix_cholesky *chol) {
+    if (chol) {
+        if (chol->owns_L) {
+            matrix_free(chol->L);
+        }
+        matrix_mem_free(chol);
+    }
+}
+
+// Solves A * X = B for every column of B using the factorization A = L * L^T
+matrix *matrix_cholesky_ls_solve(const matrix_cholesky *chol, matrix *b) {
+    if (!chol || !chol->L || !b || chol->L->num_rows != b->num_rows) {
+        fprintf(stderr, "Dimensions of matrix are not valid.\n");
+        return NULL;
+    }
+    if (!same_dtype(chol->L, b)) {
+        return NULL;
+    }
+
+    matrix *x = matrix_copy(b);
+    if (!x) {
+        return NULL;
+    }
+
+    // Solve L*Y = B and then L^T*X = Y in place
+    trsm_left(chol->L, true, false, false, x);
+    trsm_left(chol->L, true, true, false, x);
+
+    return x;
+}
+
+// Computes the inverse of A from A = L * L^T (LAPACK potri style), into dst or a new
+// matrix if dst is NULL. dst may be the factor itself.
+matrix *matrix_cholesky_inv(const matrix_cholesky *chol, matrix *dst) {
+    if (!chol || !chol->L) {
+        fprintf(stderr, "Invalid Cholesky decomposition for inversion.\n");
+        return NULL;
+    }
+
+    size_t n = chol->L->num_rows;
+    bool owns_dst = (dst == NULL);
+    if (owns_dst) {
+        dst = matrix_new(n, n, matrix_element_size(chol->L));
+        if (!dst) {
+            return NULL;
+        }
+    } else if (!matrix_eqdim(dst, chol->L)) {
+        fprintf(stderr, "Output matrix must have the same dimensions as the factored matrix.\n");
+        return NULL;
+    } else if (!same_dtype(dst, chol->L)) {
+        return NULL;
+    }
+
+    if (dst != chol->L) {
+        copy_rows(dst, chol->L);
+    }
+    if (potri(dst) != 0) {
+        fprintf(stderr, "Matrix is singular and cannot be inverted.\n");
+        if (owns_dst) {
+            matrix_free(dst);
+        }
+        return NULL;
+    }
+    return dst;
+}
+
+// Log-determinant of A = L * L^T, 2 * sum(log L_ii); does not overflow like the determinant
+double matrix_cholesky_logdet(const matrix_cholesky *chol) {
+    size_t n = chol->L->num_rows;
+    double logdet = 0.0;
+
+    for (size_t i = 0; i < n; i++) {
+        logdet += log(matrix_get(chol->L, i, i));
+    }
+    return 2.0 * logdet;
+}
+
 // Function to free memory allocated for Cholesky decomposition
 void matrix_cholesky_free(matrix_lup *cholesky) {
     if (cholesky) {
         matrix_free(cholesky->L);
-        free(cholesky);
+        matrix_mem_free(cholesky);
     }
 }
@@ -0,0 +1,207 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__unix__)
+#include <sys/mman.h>
+#endif
+
+// Every heap allocation the library makes goes through the installed allocator,
+// libc's by default. The size cap only applies to matrix data and large kernel
+// scratch. With the libc allocator, those large buffers are mapped directly from the kernel instead:
+// the pages arrive zeroed on first touch, so nothing is memset up front, and
+// they can be backed by huge pages to cut TLB misses.
+
+// Largest matrix data buffer allocated unless MATRIX_MAX_ALLOCATION or the caller says otherwise
+#define MATRIX_DEFAULT_MAX_ALLOCATION ((size_t)1024 * 1024 * 1024) // 1 GB
+
+// Matrix buffers at least this large are mapped rather than taken from the heap
+#define MATRIX_DEFAULT_MMAP_THRESHOLD ((size_t)4 * 1024 * 1024)
+
+// Explicit huge pages are assumed to be the common 2 MiB size
+#define MATRIX_HUGE_PAGE_SIZE ((size_t)2 * 1024 * 1024)
+
+// Data buffers start this far into their mapping; the bytes before hold the mapping length
+#define MAPPED_HEADER 4096
+
+static void *libc_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void *libc_aligned_alloc(void *ctx, size_t alignment, size_t size) {
+    (void)ctx;
+    return aligned_alloc(alignment, size);
+}
+
+static void libc_free(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const matrix_allocator libc_allocator = { libc_alloc, libc_aligned_alloc, libc_free, NULL };
+
+static matrix_allocator allocator = { libc_alloc, libc_aligned_alloc, libc_free, NULL };
+static size_t max_allocation = 0;  // 0 until resolved from the environment
+static size_t mmap_threshold = MATRIX_DEFAULT_MMAP_THRESHOLD;
+static matrix_huge_pages huge_pages = MATRIX_HUGE_PAGES_TRANSPARENT;
+
+bool matrix_set_allocator(const matrix_allocator *custom) {
+    if (!custom) {
+        allocator = libc_allocator;
+        return true;
+    }
+    if (!custom->alloc || !custom->aligned_alloc || !custom->free) {
+        return false;
+    }
+    allocator = *custom;
+    return true;
+}
+
+matrix_allocator matrix_get_allocator(void) {
+    return allocator;
+}
+
+// MATRIX_MAX_ALLOCATION takes a byte count with an optional K, M, G or T suffix
+static size_t default_max_allocation(void) {
+    const char *env = getenv("MATRIX_MAX_ALLOCATION");
+    if (env && *env) {
+        char *end;
+        unsigned long long n = strtoull(env, &end, 10);
+        unsigned int shift = 0;
+        switch (*end) {
+            case 'K': case 'k': shift = 10; end++; break;
+            case 'M': case 'm': shift = 20; end++; break;
+            case 'G': case 'g': shift = 30; end++; break;
+            case 'T': case 't': shift = 40; end++; break;
+            default: break;
+        }
+        if (*end == '\0' && end != env && n > 0 && n <= (SIZE_MAX >> shift)) {
+            return (size_t)n << shift;
+        }
+        fprintf(stderr, "Ignoring invalid MATRIX_MAX_ALLOCATION value \"%s\".\n", env);
+    }
+    return MATRIX_DEFAULT_MAX_ALLOCATION;
+}
+
+void matrix_set_max_allocation(size_t bytes) {
+    max_allocation = bytes ? bytes : default_max_allocation();
+}
+
+size_t matrix_get_max_allocation(void) {
+    if (max_allocation == 0) {
+        max_allocation = default_max_allocation();
+    }
+    return max_allocation;
+}
+
+void matrix_set_mmap_threshold(size_t bytes) {
+    mmap_threshold = bytes ? bytes : MATRIX_DEFAULT_MMAP_THRESHOLD;
+}
+
+void matrix_set_huge_pages(matrix_huge_pages mode) {
+    huge_pages = mode;
+}
+
+void *matrix_mem_alloc(size_t size) {
+    return allocator.alloc(allocator.ctx, size);
+}
+
+void *matrix_mem_aligned_alloc(size_t alignment, size_t size) {
+    if (size > SIZE_MAX - alignment) {
+        return NULL;
+    }
+    // C11 aligned_alloc wants a multiple of the alignment, so every allocator gets one
+    size = (size + alignment - 1) & ~(alignment - 1);
+    return allocator.aligned_alloc(allocator.ctx, alignment, size);
+}
+
+void matrix_mem_free(void *ptr) {
+    if (ptr) {
+        allocator.free(allocator.ctx, ptr);
+    }
+}
+
+#if defined(__unix__) && defined(MAP_ANONYMOUS)
+// Maps len bytes of zeroed memory, with the configured huge-page treatment
+static void *map_pages(size_t len) {
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (huge_pages == MATRIX_HUGE_PAGES_EXPLICIT) {
+        // Needs a hugetlbfs pool; fall back to ordinary pages if there is none
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        if (huge_pages != MATRIX_HUGE_PAGES_NONE) {
+            madvise(p, len, MADV_HUGEPAGE);  // advice only, so failure is harmless
+        }
+#endif
+    }
+    return p;
+}
+#endif
+
+// Mapped pages are always zero; zero says whether heap memory must be cleared too
+static void *data_alloc(size_t size, size_t alignment, bool *mapped, bool zero) {
+    *mapped = false;
+    if (size > SIZE_MAX - MATRIX_HUGE_PAGE_SIZE - MAPPED_HEADER) {
+        return NULL;
+    }
+
+#if defined(__unix__) && defined(MAP_ANONYMOUS)
+    // Custom allocators get every buffer; only libc's is bypassed for large ones
+    if (size >= mmap_threshold && allocator.alloc == libc_alloc && alignment <= MAPPED_HEADER) {
+        size_t len = size + MAPPED_HEADER;
+        if (huge_pages == MATRIX_HUGE_PAGES_EXPLICIT) {
+            len = (len + MATRIX_HUGE_PAGE_SIZE - 1) & ~(MATRIX_HUGE_PAGE_SIZE - 1);
+        }
+        unsigned char *base = map_pages(len);
+        if (base) {
+            memcpy(base, &len, sizeof(len));
+            *mapped = true;
+            return base + MAPPED_HEADER;
+        }
+    }
+#endif
+
+    void *data = matrix_mem_aligned_alloc(alignment, size);
+    if (data && zero) {
+        memset(data, 0, size);
+    }
+    return data;
+}
+
+void *matrix_mem_data_alloc(size_t size, size_t alignment, bool *mapped) {
+    return data_alloc(size, alignment, mapped, true);
+}
+
+void *matrix_mem_scratch_alloc(size_t size, size_t alignment, bool *mapped) {
+    *mapped = false;
+    if (size > matrix_get_max_allocation()) {
+        return NULL;
+    }
+    return data_alloc(size, alignment, mapped, false);
+}
+
+void matrix_mem_data_free(void *data, bool mapped) {
+#if defined(__unix__) && defined(MAP_ANONYMOUS)
+    if (mapped) {
+        unsigned char *base = (unsigned char *)data - MAPPED_HEADER;
+        size_t len;
+        memcpy(&len, base, sizeof(len));
+        munmap(base, len);
+        return;
+    }
+#else
+    (void)mapped;
+#endif
+    matrix_mem_free(data);
+}
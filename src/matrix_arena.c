@@ -0,0 +1,235 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include <pthread.h>
+#include <stdint.h>
+
+// Workspace arenas. An arena is a chain of blocks handed out as a stack: kernels
+// take a mark, carve their scratch off the current block and drop back to the mark
+// when done. Blocks are kept when the stack unwinds, so once an arena has grown to
+// a workload's peak, later calls never allocate. Requests sized by the problem
+// (above ARENA_LARGE) are not kept: they come from the heap through the allocation
+// cap and the mmap path, and go back when the stack unwinds past them, so one big
+// call does not pin its peak in every thread that served it.
+
+#define ARENA_ALIGN 64
+
+// First block of an arena created on demand for a thread
+#define ARENA_DEFAULT_CAPACITY (256 * 1024)
+
+// Larger requests bypass the blocks, and no block grows past this by doubling
+#define ARENA_LARGE ((size_t)4 * 1024 * 1024)
+
+typedef struct matrix_arena_block {
+    struct matrix_arena_block *next;
+    size_t size;  // usable bytes in data
+    size_t used;
+    unsigned char *data;
+} matrix_arena_block;
+
+// A heap buffer handed out for a large request; the record itself lives in the arena
+typedef struct matrix_arena_large {
+    struct matrix_arena_large *prev;
+    void *data;
+    bool mapped;
+} matrix_arena_large;
+
+struct matrix_arena {
+    matrix_arena_block *first;
+    matrix_arena_block *current;
+    matrix_arena_large *large;   // live large buffers, newest first
+    matrix_allocator allocator;  // the one installed when the arena was made, used for all its blocks
+};
+
+// The arena scratch comes from on this thread: one set with matrix_arena_use, else
+// the thread's own default arena, created on first use and freed at thread exit
+static _Thread_local matrix_arena *current_arena = NULL;
+static _Thread_local matrix_arena *default_arena = NULL;
+
+static pthread_key_t default_arena_key;
+static pthread_once_t default_arena_once = PTHREAD_ONCE_INIT;
+
+static matrix_arena_block *block_new(const matrix_allocator *a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    matrix_arena_block *block = a->alloc(a->ctx, sizeof(matrix_arena_block));
+    if (!block) {
+        return NULL;
+    }
+    block->data = a->aligned_alloc(a->ctx, ARENA_ALIGN, size);
+    if (!block->data) {
+        a->free(a->ctx, block);
+        return NULL;
+    }
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+static void block_free(const matrix_allocator *a, matrix_arena_block *block) {
+    a->free(a->ctx, block->data);
+    a->free(a->ctx, block);
+}
+
+matrix_arena *matrix_arena_new(size_t capacity) {
+    matrix_allocator a = matrix_get_allocator();
+    matrix_arena *arena = a.alloc(a.ctx, sizeof(matrix_arena));
+    if (!arena) {
+        return NULL;
+    }
+    arena->allocator = a;
+    arena->first = block_new(&a, capacity ? capacity : ARENA_DEFAULT_CAPACITY);
+    if (!arena->first) {
+        a.free(a.ctx, arena);
+        return NULL;
+    }
+    arena->current = arena->first;
+    arena->large = NULL;
+    return arena;
+}
+
+// Returns the large buffers handed out after `keep` to the heap
+static void release_large(matrix_arena *arena, matrix_arena_large *keep) {
+    while (arena->large != keep) {
+        matrix_arena_large *l = arena->large;
+        arena->large = l->prev;
+        matrix_mem_data_free(l->data, l->mapped);
+    }
+}
+
+void matrix_arena_free(matrix_arena *arena) {
+    if (!arena) {
+        return;
+    }
+    if (current_arena == arena) {
+        current_arena = NULL;
+    }
+    release_large(arena, NULL);
+    matrix_allocator a = arena->allocator;
+    matrix_arena_block *block = arena->first;
+    while (block) {
+        matrix_arena_block *next = block->next;
+        block_free(&a, block);
+        block = next;
+    }
+    a.free(a.ctx, arena);
+}
+
+void matrix_arena_reset(matrix_arena *arena) {
+    if (arena) {
+        release_large(arena, NULL);
+        arena->current = arena->first;
+        arena->first->used = 0;
+    }
+}
+
+size_t matrix_arena_capacity(const matrix_arena *arena) {
+    size_t total = 0;
+    for (const matrix_arena_block *block = arena ? arena->first : NULL; block; block = block->next) {
+        total += block->size;
+    }
+    return total;
+}
+
+matrix_arena *matrix_arena_use(matrix_arena *arena) {
+    matrix_arena *previous = current_arena;
+    current_arena = arena;
+    return previous;
+}
+
+static void default_arena_destroy(void *arena) {
+    matrix_arena_free(arena);
+}
+
+static void default_arena_key_create(void) {
+    pthread_key_create(&default_arena_key, default_arena_destroy);
+}
+
+static matrix_arena *thread_arena(void) {
+    if (current_arena) {
+        return current_arena;
+    }
+    if (!default_arena) {
+        pthread_once(&default_arena_once, default_arena_key_create);
+        default_arena = matrix_arena_new(ARENA_DEFAULT_CAPACITY);
+        if (default_arena) {
+            pthread_setspecific(default_arena_key, default_arena);
+        }
+    }
+    return default_arena;
+}
+
+void *matrix_arena_alloc(matrix_arena *arena, size_t bytes) {
+    if (!arena) {
+        return NULL;
+    }
+    if (bytes > SIZE_MAX - ARENA_ALIGN) {
+        return NULL;
+    }
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if (bytes > ARENA_LARGE) {
+        matrix_arena_large *l = matrix_arena_alloc(arena, sizeof(matrix_arena_large));
+        if (!l) {
+            return NULL;
+        }
+        l->data = matrix_mem_scratch_alloc(bytes, ARENA_ALIGN, &l->mapped);
+        if (!l->data) {
+            return NULL;
+        }
+        l->prev = arena->large;
+        arena->large = l;
+        return l->data;
+    }
+
+    matrix_arena_block *block = arena->current;
+    if (block->size - block->used < bytes) {
+        // Move on to the next block, replacing it with a bigger one if it is missing or
+        // too small; blocks past the current one hold nothing live
+        matrix_arena_block *next = block->next;
+        if (!next || next->size < bytes) {
+            size_t size = (block->size * 2 < ARENA_LARGE) ? block->size * 2 : ARENA_LARGE;
+            if (size < bytes) {
+                size = bytes;
+            }
+            matrix_arena_block *fresh = block_new(&arena->allocator, size);
+            if (!fresh) {
+                return NULL;
+            }
+            if (next) {
+                fresh->next = next->next;
+                block_free(&arena->allocator, next);
+            }
+            block->next = fresh;
+            next = fresh;
+        }
+        next->used = 0;
+        arena->current = block = next;
+    }
+
+    void *p = block->data + block->used;
+    block->used += bytes;
+    return p;
+}
+
+matrix_scratch_mark matrix_scratch_begin(void) {
+    matrix_arena *arena = thread_arena();
+    matrix_scratch_mark mark = { arena, NULL, 0, NULL };
+    if (arena) {
+        mark.block = arena->current;
+        mark.used = arena->current->used;
+        mark.large = arena->large;
+    }
+    return mark;
+}
+
+void *matrix_scratch_alloc(matrix_scratch_mark mark, size_t bytes) {
+    return matrix_arena_alloc(mark.arena, bytes);
+}
+
+void matrix_scratch_end(matrix_scratch_mark mark) {
+    if (mark.arena) {
+        release_large(mark.arena, mark.large);
+        mark.arena->current = mark.block;
+        mark.block->used = mark.used;
+    }
+}
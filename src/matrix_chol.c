@@ -0,0 +1,147 @@
+#include "matrix_internal.h"
+#include "matrix_real.h"
+#include <tgmath.h>
+
+// Right-looking blocked Cholesky (LAPACK potrf, lower). Each NB x NB diagonal
+// block is factored directly, the panel below it comes from a triangular solve
+// and the trailing lower triangle gets a GEMM update. Only the lower triangle
+// of A is read or written, and the transposed operands are read in place.
+
+#define CHOL_NB 128
+
+// Unblocked Cholesky of the nb x nb lower triangle at A, in dot-product form so
+// every inner loop runs along a row. Returns the failing column + 1, or 0.
+static int potf2(size_t nb, real *A, size_t lda) {
+    for (size_t j = 0; j < nb; j++) {
+        real *aj = A + j * lda;
+        real d = aj[j];
+        for (size_t p = 0; p < j; p++) {
+            d -= aj[p] * aj[p];
+        }
+        if (!(d > 0.0)) {
+            return (int)j + 1;  // also catches NaN
+        }
+        d = sqrt(d);
+        aj[j] = d;
+
+        for (size_t i = j + 1; i < nb; i++) {
+            real *ai = A + i * lda;
+            real sum = ai[j];
+            for (size_t p = 0; p < j; p++) {
+                sum -= ai[p] * aj[p];
+            }
+            ai[j] = sum / d;
+        }
+    }
+    return 0;
+}
+
+int MATRIX_FN(potrf)(size_t n, real *A, size_t lda) {
+    if (n <= CHOL_NB) {
+        return potf2(n, A, lda);
+    }
+
+    int info = 0;
+    for (size_t j = 0; j < n; j += CHOL_NB) {
+        size_t nb = (n - j < CHOL_NB) ? n - j : CHOL_NB;
+        real *a11 = A + j * lda + j;
+
+        info = potf2(nb, a11, lda);
+        if (info != 0) {
+            info += (int)j;
+            break;
+        }
+        if (j + nb == n) {
+            break;
+        }
+
+        // L21 = A21 * inv(L11)^T
+        size_t rest = n - j - nb;
+        real *a21 = A + (j + nb) * lda + j;
+        MATRIX_FN(trsm_right)(true, true, false, rest, nb, a11, lda, a21, lda);
+
+        // A22 -= L21 * L21^T, lower triangle only
+        if (MATRIX_FN(syrk)(true, false, rest, nb, -1.0, a21, lda, 1.0, a21 + nb, lda) != 0) {
+            return -1;
+        }
+    }
+    return info;
+}
+
+// A = L^T * A in place for an nb x nb lower triangle L and an nb x n block A, top down.
+static void trmm_lower_trans(size_t nb, size_t n, const real *L, size_t ldl, real *A, size_t lda) {
+    for (size_t r = 0; r < nb; r++) {
+        real *ar = A + r * lda;
+        real t = L[r * ldl + r];
+        for (size_t j = 0; j < n; j++) {
+            ar[j] *= t;
+        }
+        for (size_t q = r + 1; q < nb; q++) {
+            const real *aq = A + q * lda;
+            t = L[q * ldl + r];
+            for (size_t j = 0; j < n; j++) {
+                ar[j] += t * aq[j];
+            }
+        }
+    }
+}
+
+// Lower triangle of L^T * L for the nb x nb lower triangle at A, in place, top down.
+static void lauu2_lower(size_t nb, real *A, size_t lda) {
+    for (size_t i = 0; i < nb; i++) {
+        real *ai = A + i * lda;
+        for (size_t j = 0; j <= i; j++) {
+            real sum = ai[i] * ai[j];
+            for (size_t p = i + 1; p < nb; p++) {
+                sum += A[p * lda + i] * A[p * lda + j];
+            }
+            ai[j] = sum;
+        }
+    }
+}
+
+int MATRIX_FN(potri)(size_t n, real *A, size_t lda) {
+    for (size_t i = 0; i < n; i++) {
+        if (A[i * lda + i] == 0.0) {
+            return -1;
+        }
+    }
+
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *tile = matrix_scratch_alloc(mark, CHOL_NB * CHOL_NB * sizeof(real));
+    if (!tile) {
+        matrix_scratch_end(mark);
+        return -1;
+    }
+
+    // W = inv(L), then inv(A) = W^T * W block row by block row (LAPACK lauum)
+    MATRIX_FN(trtri)(true, n, A, lda);
+
+    for (size_t i0 = 0; i0 < n; i0 += CHOL_NB) {
+        size_t ib = (n - i0 < CHOL_NB) ? n - i0 : CHOL_NB;
+        size_t i1 = i0 + ib;
+        real *a10 = A + i0 * lda;
+        real *a11 = a10 + i0;
+
+        trmm_lower_trans(ib, i0, a11, lda, a10, lda);
+        lauu2_lower(ib, a11, lda);
+
+        if (i1 < n) {
+            // Add the contributions of the rows below: W21^T * [W20 W21]
+            size_t rest = n - i1;
+            const real *a21 = A + i1 * lda + i0;
+            MATRIX_FN(gemm)(true, false, ib, i0, rest, 1.0, a21, lda, A + i1 * lda, lda, 1.0, a10, lda);
+            MATRIX_FN(gemm)(true, false, ib, ib, rest, 1.0, a21, lda, a21, lda, 0.0, tile, CHOL_NB);
+            for (size_t i = 0; i < ib; i++) {
+                for (size_t j = 0; j <= i; j++) {
+                    a11[i * lda + j] += tile[i * CHOL_NB + j];
+                }
+            }
+        }
+    }
+    matrix_scratch_end(mark);
+
+    // Mirror the lower triangle so the caller gets the full symmetric inverse
+    MATRIX_FN(symmetrize)(true, n, A, lda);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Run-time kernel dispatch. The CPU is probed once, when the library is loaded,
+// and a table of function pointers is filled from the portable kernels upwards:
+// each instruction set the CPU (and MATRIX_ISA) allows overwrites the entries it
+// has a faster variant for. Kernels then call through the table, so one binary
+// runs everything from SSE4.2 boxes to AVX-512 servers at full speed.
+
+static void dadd_scalar(size_t n, const double *x, double s, const double *y, double *z, bool stream) {
+    (void)stream;
+    for (size_t i = 0; i < n; i++) {
+        z[i] = x[i] + s * y[i];
+    }
+}
+
+static void dscal_scalar(size_t n, double s, double *x) {
+    for (size_t i = 0; i < n; i++) {
+        x[i] *= s;
+    }
+}
+
+static void dfill_scalar(size_t n, double v, double *x, bool stream) {
+    (void)stream;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = v;
+    }
+}
+
+static void dcopy_scalar(size_t n, const double *x, double *z, bool stream) {
+    (void)stream;
+    memcpy(z, x, n * sizeof(double));
+}
+
+static void sadd_scalar(size_t n, const float *x, float s, const float *y, float *z, bool stream) {
+    (void)stream;
+    for (size_t i = 0; i < n; i++) {
+        z[i] = x[i] + s * y[i];
+    }
+}
+
+static void sscal_scalar(size_t n, float s, float *x) {
+    for (size_t i = 0; i < n; i++) {
+        x[i] *= s;
+    }
+}
+
+static void sfill_scalar(size_t n, float v, float *x, bool stream) {
+    (void)stream;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = v;
+    }
+}
+
+static void daxpy_scalar(size_t n, double s, const double *x, double *y) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+static void saxpy_scalar(size_t n, float s, const float *x, float *y) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+static void dtranspose_scalar(size_t rows, size_t cols, const double *src, size_t lds,
+                              double *dst, size_t ldd) {
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+static void stranspose_scalar(size_t rows, size_t cols, const float *src, size_t lds,
+                              float *dst, size_t ldd) {
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+static const char *const isa_names[] = { "scalar", "sse4.2", "avx2", "avx512" };
+
+static matrix_kernels kernels;
+static matrix_isa cpu_isa;  // best level the CPU supports
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static matrix_isa detect_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    // Needed because this may run from a constructor, before libgcc has probed the CPU
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (avx2 && __builtin_cpu_supports("avx512f")) {
+        return MATRIX_ISA_AVX512;
+    }
+    if (avx2) {
+        return MATRIX_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return MATRIX_ISA_SSE42;
+    }
+#endif
+    return MATRIX_ISA_SCALAR;
+}
+
+// Fills the table with the best variants at or below cap
+static void install(matrix_isa cap) {
+    matrix_kernels k = {
+        .isa = MATRIX_ISA_SCALAR,
+        .dgemm = matrix_dgemm_ref_config(),
+        .sgemm = matrix_sgemm_ref_config(),
+        .dadd = dadd_scalar,
+        .dscal = dscal_scalar,
+        .dfill = dfill_scalar,
+        .dcopy = dcopy_scalar,
+        .sadd = sadd_scalar,
+        .sscal = sscal_scalar,
+        .sfill = sfill_scalar,
+        .daxpy = daxpy_scalar,
+        .saxpy = saxpy_scalar,
+        .dtranspose = dtranspose_scalar,
+        .stranspose = stranspose_scalar,
+    };
+    if (cap > cpu_isa) {
+        cap = cpu_isa;
+    }
+    if (cap >= MATRIX_ISA_SSE42 && matrix_kernels_sse42(&k)) {
+        k.isa = MATRIX_ISA_SSE42;
+    }
+    if (cap >= MATRIX_ISA_AVX2 && matrix_kernels_avx2(&k)) {
+        k.isa = MATRIX_ISA_AVX2;
+    }
+    if (cap >= MATRIX_ISA_AVX512 && matrix_kernels_avx512(&k)) {
+        k.isa = MATRIX_ISA_AVX512;
+    }
+    kernels = k;
+}
+
+// MATRIX_ISA names a level by its matrix_isa_name
+static matrix_isa default_isa(void) {
+    const char *env = getenv("MATRIX_ISA");
+    if (env && *env) {
+        for (size_t i = 0; i < sizeof(isa_names) / sizeof(isa_names[0]); i++) {
+            if (strcmp(env, isa_names[i]) == 0) {
+                return (matrix_isa)i;
+            }
+        }
+        fprintf(stderr, "Ignoring invalid MATRIX_ISA value \"%s\".\n", env);
+    }
+    return MATRIX_ISA_AVX512;
+}
+
+static void kernels_init(void) {
+    cpu_isa = detect_isa();
+    install(default_isa());
+}
+
+// Resolve at load time so the first kernel call does not pay for the probe
+__attribute__((constructor)) static void kernels_load(void) {
+    pthread_once(&kernels_once, kernels_init);
+}
+
+const matrix_kernels *matrix_kernels_get(void) {
+    pthread_once(&kernels_once, kernels_init);
+    return &kernels;
+}
+
+matrix_isa matrix_set_isa(matrix_isa isa) {
+    pthread_once(&kernels_once, kernels_init);
+    install(isa);
+    return kernels.isa;
+}
+
+matrix_isa matrix_get_isa(void) {
+    return matrix_kernels_get()->isa;
+}
+
+const char *matrix_isa_name(matrix_isa isa) {
+    if ((size_t)isa >= sizeof(isa_names) / sizeof(isa_names[0])) {
+        return "unknown";
+    }
+    return isa_names[isa];
+}
@@ -0,0 +1,307 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include "matrix_real.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Goto/BLIS style GEMM: B is packed into KC x NC row panels that stay in L3,
+// A into MC x KC column panels that stay in L2, and a register-tiled
+// micro-kernel streams both out of L1. Transposed operands only change how
+// the panels are gathered; the packed layout, and so the kernels, are the same.
+
+#define GEMM_ALIGN 64
+
+// Below this many multiply-adds packing costs more than it saves.
+#define GEMM_SMALL_FLOPS (48.0 * 48.0 * 48.0)
+
+#define REF_MR 4
+#define REF_NR 4
+
+// Portable micro-kernel, written so the compiler can keep the tile in registers.
+static void gemm_ukr_ref(size_t kc, const real *a, const real *b,
+                         real *c, size_t ldc, real alpha, real beta) {
+    real ab[REF_MR * REF_NR] = {0.0};
+
+    for (size_t p = 0; p < kc; p++) {
+        for (size_t i = 0; i < REF_MR; i++) {
+            for (size_t j = 0; j < REF_NR; j++) {
+                ab[i * REF_NR + j] += a[i] * b[j];
+            }
+        }
+        a += REF_MR;
+        b += REF_NR;
+    }
+
+    for (size_t i = 0; i < REF_MR; i++) {
+        for (size_t j = 0; j < REF_NR; j++) {
+            real v = alpha * ab[i * REF_NR + j];
+            c[i * ldc + j] = (beta == 0.0) ? v : v + beta * c[i * ldc + j];
+        }
+    }
+}
+
+static const MATRIX_FN(gemm_config) gemm_ref_config = {
+    "ref", gemm_ukr_ref, REF_MR, REF_NR, 64, 256, 4096
+};
+
+const MATRIX_FN(gemm_config) *MATRIX_FN(gemm_ref_config)(void) {
+    return &gemm_ref_config;
+}
+
+// Packing buffers come from the thread's scratch arena, which aligns to GEMM_ALIGN
+static real *gemm_buffer(matrix_scratch_mark mark, size_t count) {
+    return matrix_scratch_alloc(mark, count * sizeof(real));
+}
+
+// Packs rows [0, mc) and columns [0, kc) of op(A) into mr-row panels, zero-padding the
+// last one. With trans, A is stored kc x mc and each packed column is a run of one row.
+static void pack_a(bool trans, size_t mc, size_t kc, const real *A, size_t lda, size_t mr, real *buf) {
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t rows = (mc - ir < mr) ? mc - ir : mr;
+        if (trans) {
+            for (size_t p = 0; p < kc; p++) {
+                memcpy(buf + p * mr, A + p * lda + ir, rows * sizeof(real));
+            }
+        } else {
+            for (size_t i = 0; i < rows; i++) {
+                const real *a = A + (ir + i) * lda;
+                for (size_t p = 0; p < kc; p++) {
+                    buf[p * mr + i] = a[p];
+                }
+            }
+        }
+        for (size_t i = rows; i < mr; i++) {
+            for (size_t p = 0; p < kc; p++) {
+                buf[p * mr + i] = 0.0;
+            }
+        }
+        buf += mr * kc;
+    }
+}
+
+// Packs rows [0, kc) and columns [0, nc) of op(B) into nr-column panels, zero-padding the
+// last one. With trans, B is stored nc x kc and is read along its rows.
+static void pack_b(bool trans, size_t kc, size_t nc, const real *B, size_t ldb, size_t nr, real *buf) {
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = (nc - jr < nr) ? nc - jr : nr;
+        if (trans) {
+            for (size_t j = 0; j < cols; j++) {
+                const real *b = B + (jr + j) * ldb;
+                for (size_t p = 0; p < kc; p++) {
+                    buf[p * nr + j] = b[p];
+                }
+            }
+            for (size_t p = 0; p < kc; p++) {
+                for (size_t j = cols; j < nr; j++) {
+                    buf[p * nr + j] = 0.0;
+                }
+            }
+            buf += nr * kc;
+            continue;
+        }
+        for (size_t p = 0; p < kc; p++) {
+            const real *b = B + p * ldb + jr;
+            for (size_t j = 0; j < cols; j++) {
+                buf[j] = b[j];
+            }
+            for (size_t j = cols; j < nr; j++) {
+                buf[j] = 0.0;
+            }
+            buf += nr;
+        }
+    }
+}
+
+static void macro_kernel(const MATRIX_FN(gemm_config) *cfg, size_t mc, size_t nc, size_t kc,
+                         real alpha, const real *packed_a, const real *packed_b,
+                         real beta, real *C, size_t ldc) {
+    size_t mr = cfg->mr, nr = cfg->nr;
+    _Alignas(GEMM_ALIGN) real tile[MATRIX_GEMM_MAX_MR * MATRIX_GEMM_MAX_NR];
+
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = (nc - jr < nr) ? nc - jr : nr;
+        const real *b = packed_b + jr * kc;
+
+        for (size_t ir = 0; ir < mc; ir += mr) {
+            size_t rows = (mc - ir < mr) ? mc - ir : mr;
+            const real *a = packed_a + ir * kc;
+            real *c = C + ir * ldc + jr;
+
+            if (rows == mr && cols == nr) {
+                cfg->kernel(kc, a, b, c, ldc, alpha, beta);
+                continue;
+            }
+
+            // Edge tile: run the full kernel into scratch and merge the valid part
+            cfg->kernel(kc, a, b, tile, nr, 1.0, 0.0);
+            for (size_t i = 0; i < rows; i++) {
+                for (size_t j = 0; j < cols; j++) {
+                    real v = alpha * tile[i * nr + j];
+                    c[i * ldc + j] = (beta == 0.0) ? v : v + beta * c[i * ldc + j];
+                }
+            }
+        }
+    }
+}
+
+static void scale_c(size_t m, size_t n, real beta, real *C, size_t ldc) {
+    for (size_t i = 0; i < m; i++) {
+        real *c = C + i * ldc;
+        if (beta == 0.0) {
+            memset(c, 0, n * sizeof(real));
+        } else if (beta != 1.0) {
+            for (size_t j = 0; j < n; j++) {
+                c[j] *= beta;
+            }
+        }
+    }
+}
+
+// Row-oriented i-k-j loop for products too small to amortize packing. With transb
+// the inner loop becomes a dot product along rows of B instead.
+static void gemm_small(bool transa, bool transb, size_t m, size_t n, size_t k, real alpha,
+                       const real *A, size_t lda, const real *B, size_t ldb,
+                       real beta, real *C, size_t ldc) {
+    size_t ars = transa ? 1 : lda, acs = transa ? lda : 1;
+    scale_c(m, n, beta, C, ldc);
+    for (size_t i = 0; i < m; i++) {
+        real *c = C + i * ldc;
+        if (transb) {
+            for (size_t j = 0; j < n; j++) {
+                const real *b = B + j * ldb;
+                real sum = 0.0;
+                for (size_t p = 0; p < k; p++) {
+                    sum += A[i * ars + p * acs] * b[p];
+                }
+                c[j] += alpha * sum;
+            }
+            continue;
+        }
+        for (size_t p = 0; p < k; p++) {
+            real a = alpha * A[i * ars + p * acs];
+            const real *b = B + p * ldb;
+            for (size_t j = 0; j < n; j++) {
+                c[j] += a * b[j];
+            }
+        }
+    }
+}
+
+// Products below this many multiply-adds stay on the calling thread.
+#define GEMM_PARALLEL_FLOPS (128.0 * 128.0 * 128.0)
+
+// Aim for this many compute tiles per thread so uneven tiles still balance.
+#define GEMM_TILES_PER_THREAD 4
+
+// State for one KC x NC slab of the product, shared by all worker tasks.
+typedef struct {
+    const MATRIX_FN(gemm_config) *cfg;
+    bool transa, transb;
+    const real *A, *B;
+    size_t lda, ldb, ldc;
+    real *C;
+    real alpha, beta;
+    size_t m, nc, kc;
+    size_t num_ic;      // MC row blocks of A and C
+    size_t num_jr;      // column chunks of B and C
+    size_t jr_chunk;    // columns per chunk, a multiple of nr
+    real *packed_b;   // the whole KC x NC panel of B, nr panels
+} gemm_slab;
+
+// Packs one chunk of B's panel.
+static void gemm_pack_task(void *ctx, size_t task) {
+    const gemm_slab *s = ctx;
+    size_t j0 = task * s->jr_chunk;
+    size_t cols = (s->nc - j0 < s->jr_chunk) ? s->nc - j0 : s->jr_chunk;
+    const real *b = s->transb ? s->B + j0 * s->ldb : s->B + j0;
+    pack_b(s->transb, s->kc, cols, b, s->ldb, s->cfg->nr, s->packed_b + j0 * s->kc);
+}
+
+// One MC x jr_chunk tile of C. The task packs its MC x KC block of A into the running
+// thread's own arena, so A's scratch is one L2-sized block per thread whatever m is.
+static void gemm_compute_task(void *ctx, size_t task) {
+    const gemm_slab *s = ctx;
+    const MATRIX_FN(gemm_config) *cfg = s->cfg;
+    size_t ic = (task / s->num_jr) * cfg->mc;
+    size_t j0 = (task % s->num_jr) * s->jr_chunk;
+    size_t mc = (s->m - ic < cfg->mc) ? s->m - ic : cfg->mc;
+    size_t cols = (s->nc - j0 < s->jr_chunk) ? s->nc - j0 : s->jr_chunk;
+    const real *a = s->transa ? s->A + ic : s->A + ic * s->lda;
+    real *c = s->C + ic * s->ldc + j0;
+
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *packed_a = gemm_buffer(mark, ((mc + cfg->mr - 1) / cfg->mr) * cfg->mr * s->kc);
+    if (packed_a) {
+        pack_a(s->transa, mc, s->kc, a, s->lda, cfg->mr, packed_a);
+        macro_kernel(cfg, mc, cols, s->kc, s->alpha, packed_a, s->packed_b + j0 * s->kc, s->beta, c, s->ldc);
+    } else {
+        // Out of memory for the block: still produce the right answer
+        const real *b = s->transb ? s->B + j0 * s->ldb : s->B + j0;
+        gemm_small(s->transa, s->transb, mc, cols, s->kc, s->alpha, a, s->lda, b, s->ldb, s->beta, c, s->ldc);
+    }
+    matrix_scratch_end(mark);
+}
+
+void MATRIX_FN(gemm)(bool transa, bool transb, size_t m, size_t n, size_t k, real alpha,
+                     const real *A, size_t lda,
+                     const real *B, size_t ldb,
+                     real beta, real *C, size_t ldc) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    if (k == 0 || alpha == 0.0) {
+        scale_c(m, n, beta, C, ldc);
+        return;
+    }
+
+    double flops = (double)m * (double)n * (double)k;
+    if (flops <= GEMM_SMALL_FLOPS) {
+        gemm_small(transa, transb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+        return;
+    }
+
+    const MATRIX_FN(gemm_config) *cfg = matrix_kernels_get()->MATRIX_KERNEL(gemm);
+    unsigned int num_threads = (flops <= GEMM_PARALLEL_FLOPS) ? 1 : matrix_get_num_threads();
+    size_t kc_max = (k < cfg->kc) ? k : cfg->kc;
+    size_t nc_max = (n < cfg->nc) ? n : cfg->nc;
+
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *packed_b = gemm_buffer(mark, ((nc_max + cfg->nr - 1) / cfg->nr) * cfg->nr * kc_max);
+    if (!packed_b) {
+        // Out of memory for the panels: still produce the right answer
+        matrix_scratch_end(mark);
+        gemm_small(transa, transb, m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+        return;
+    }
+
+    gemm_slab s = {
+        .cfg = cfg, .transa = transa, .transb = transb, .lda = lda, .ldb = ldb, .ldc = ldc, .alpha = alpha,
+        .m = m, .num_ic = (m + cfg->mc - 1) / cfg->mc,
+        .packed_b = packed_b,
+    };
+
+    for (size_t jc = 0; jc < n; jc += cfg->nc) {
+        s.nc = (n - jc < cfg->nc) ? n - jc : cfg->nc;
+
+        // Split the panel's columns so every thread gets several tiles
+        size_t nr_panels = (s.nc + cfg->nr - 1) / cfg->nr;
+        size_t want = ((size_t)num_threads * GEMM_TILES_PER_THREAD + s.num_ic - 1) / s.num_ic;
+        size_t parts = (num_threads == 1) ? 1 : ((want < nr_panels) ? want : nr_panels);
+        s.jr_chunk = ((nr_panels + parts - 1) / parts) * cfg->nr;
+        s.num_jr = (s.nc + s.jr_chunk - 1) / s.jr_chunk;
+
+        for (size_t pc = 0; pc < k; pc += cfg->kc) {
+            s.kc = (k - pc < cfg->kc) ? k - pc : cfg->kc;
+            s.beta = (pc == 0) ? beta : 1.0;
+            s.A = transa ? A + pc * lda : A + pc;
+            s.B = transb ? B + jc * ldb + pc : B + pc * ldb + jc;
+            s.C = C + jc;
+
+            matrix_parallel_for(num_threads, s.num_jr, gemm_pack_task, &s);
+            matrix_parallel_for(num_threads, s.num_ic * s.num_jr, gemm_compute_task, &s);
+        }
+    }
+
+    matrix_scratch_end(mark);
+}
@@ -0,0 +1,88 @@
+#include "matrix_internal.h"
+
+// Built with -mavx2 -mfma; only selected at run time on CPUs that report both.
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+#define AVX2_MR 6
+#define AVX2_NR 8
+
+static inline void store_row(double *c, __m256d lo, __m256d hi, __m256d va, __m256d vb, int accumulate) {
+    lo = _mm256_mul_pd(va, lo);
+    hi = _mm256_mul_pd(va, hi);
+    if (accumulate) {
+        lo = _mm256_fmadd_pd(vb, _mm256_loadu_pd(c), lo);
+        hi = _mm256_fmadd_pd(vb, _mm256_loadu_pd(c + 4), hi);
+    }
+    _mm256_storeu_pd(c, lo);
+    _mm256_storeu_pd(c + 4, hi);
+}
+
+// 6x8 tile held in 12 ymm accumulators; each k step broadcasts 6 values of A
+// against two vectors of B.
+static void dgemm_ukr_avx2_6x8(size_t kc, const double *a, const double *b,
+                               double *c, size_t ldc, double alpha, double beta) {
+    __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+    __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+    __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+    __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+    __m256d c40 = _mm256_setzero_pd(), c41 = _mm256_setzero_pd();
+    __m256d c50 = _mm256_setzero_pd(), c51 = _mm256_setzero_pd();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m256d b0 = _mm256_load_pd(b);
+        __m256d b1 = _mm256_load_pd(b + 4);
+        __m256d ai;
+
+        _mm_prefetch((const char *)(b + 8 * AVX2_NR), _MM_HINT_T0);
+
+        ai = _mm256_broadcast_sd(a + 0);
+        c00 = _mm256_fmadd_pd(ai, b0, c00);
+        c01 = _mm256_fmadd_pd(ai, b1, c01);
+        ai = _mm256_broadcast_sd(a + 1);
+        c10 = _mm256_fmadd_pd(ai, b0, c10);
+        c11 = _mm256_fmadd_pd(ai, b1, c11);
+        ai = _mm256_broadcast_sd(a + 2);
+        c20 = _mm256_fmadd_pd(ai, b0, c20);
+        c21 = _mm256_fmadd_pd(ai, b1, c21);
+        ai = _mm256_broadcast_sd(a + 3);
+        c30 = _mm256_fmadd_pd(ai, b0, c30);
+        c31 = _mm256_fmadd_pd(ai, b1, c31);
+        ai = _mm256_broadcast_sd(a + 4);
+        c40 = _mm256_fmadd_pd(ai, b0, c40);
+        c41 = _mm256_fmadd_pd(ai, b1, c41);
+        ai = _mm256_broadcast_sd(a + 5);
+        c50 = _mm256_fmadd_pd(ai, b0, c50);
+        c51 = _mm256_fmadd_pd(ai, b1, c51);
+
+        a += AVX2_MR;
+        b += AVX2_NR;
+    }
+
+    __m256d va = _mm256_set1_pd(alpha);
+    __m256d vb = _mm256_set1_pd(beta);
+    int accumulate = (beta != 0.0);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+    store_row(c + 4 * ldc, c40, c41, va, vb, accumulate);
+    store_row(c + 5 * ldc, c50, c51, va, vb, accumulate);
+}
+
+static const matrix_dgemm_config dgemm_avx2_config = {
+    "avx2", dgemm_ukr_avx2_6x8, AVX2_MR, AVX2_NR, 72, 256, 4080
+};
+
+const matrix_dgemm_config *matrix_dgemm_avx2_config(void) {
+    return &dgemm_avx2_config;
+}
+
+#else
+
+const matrix_dgemm_config *matrix_dgemm_avx2_config(void) {
+    return NULL;
+}
+
+#endif
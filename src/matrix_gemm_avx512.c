@@ -0,0 +1,98 @@
+#include "matrix_internal.h"
+
+// Built with -mavx512f -mfma; only selected at run time on CPUs that report AVX-512F.
+
+#if defined(__AVX512F__) && defined(__FMA__)
+#include <immintrin.h>
+
+#define AVX512_MR 8
+#define AVX512_NR 16
+
+static inline void store_row(double *c, __m512d lo, __m512d hi, __m512d va, __m512d vb, int accumulate) {
+    lo = _mm512_mul_pd(va, lo);
+    hi = _mm512_mul_pd(va, hi);
+    if (accumulate) {
+        lo = _mm512_fmadd_pd(vb, _mm512_loadu_pd(c), lo);
+        hi = _mm512_fmadd_pd(vb, _mm512_loadu_pd(c + 8), hi);
+    }
+    _mm512_storeu_pd(c, lo);
+    _mm512_storeu_pd(c + 8, hi);
+}
+
+// 8x16 tile held in 16 zmm accumulators; each k step broadcasts 8 values of A
+// against two vectors of B. Half the register file stays free for the loads.
+static void dgemm_ukr_avx512_8x16(size_t kc, const double *a, const double *b,
+                                  double *c, size_t ldc, double alpha, double beta) {
+    __m512d c00 = _mm512_setzero_pd(), c01 = _mm512_setzero_pd();
+    __m512d c10 = _mm512_setzero_pd(), c11 = _mm512_setzero_pd();
+    __m512d c20 = _mm512_setzero_pd(), c21 = _mm512_setzero_pd();
+    __m512d c30 = _mm512_setzero_pd(), c31 = _mm512_setzero_pd();
+    __m512d c40 = _mm512_setzero_pd(), c41 = _mm512_setzero_pd();
+    __m512d c50 = _mm512_setzero_pd(), c51 = _mm512_setzero_pd();
+    __m512d c60 = _mm512_setzero_pd(), c61 = _mm512_setzero_pd();
+    __m512d c70 = _mm512_setzero_pd(), c71 = _mm512_setzero_pd();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m512d b0 = _mm512_load_pd(b);
+        __m512d b1 = _mm512_load_pd(b + 8);
+        __m512d ai;
+
+        _mm_prefetch((const char *)(b + 8 * AVX512_NR), _MM_HINT_T0);
+
+        ai = _mm512_set1_pd(a[0]);
+        c00 = _mm512_fmadd_pd(ai, b0, c00);
+        c01 = _mm512_fmadd_pd(ai, b1, c01);
+        ai = _mm512_set1_pd(a[1]);
+        c10 = _mm512_fmadd_pd(ai, b0, c10);
+        c11 = _mm512_fmadd_pd(ai, b1, c11);
+        ai = _mm512_set1_pd(a[2]);
+        c20 = _mm512_fmadd_pd(ai, b0, c20);
+        c21 = _mm512_fmadd_pd(ai, b1, c21);
+        ai = _mm512_set1_pd(a[3]);
+        c30 = _mm512_fmadd_pd(ai, b0, c30);
+        c31 = _mm512_fmadd_pd(ai, b1, c31);
+        ai = _mm512_set1_pd(a[4]);
+        c40 = _mm512_fmadd_pd(ai, b0, c40);
+        c41 = _mm512_fmadd_pd(ai, b1, c41);
+        ai = _mm512_set1_pd(a[5]);
+        c50 = _mm512_fmadd_pd(ai, b0, c50);
+        c51 = _mm512_fmadd_pd(ai, b1, c51);
+        ai = _mm512_set1_pd(a[6]);
+        c60 = _mm512_fmadd_pd(ai, b0, c60);
+        c61 = _mm512_fmadd_pd(ai, b1, c61);
+        ai = _mm512_set1_pd(a[7]);
+        c70 = _mm512_fmadd_pd(ai, b0, c70);
+        c71 = _mm512_fmadd_pd(ai, b1, c71);
+
+        a += AVX512_MR;
+        b += AVX512_NR;
+    }
+
+    __m512d va = _mm512_set1_pd(alpha);
+    __m512d vb = _mm512_set1_pd(beta);
+    int accumulate = (beta != 0.0);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+    store_row(c + 4 * ldc, c40, c41, va, vb, accumulate);
+    store_row(c + 5 * ldc, c50, c51, va, vb, accumulate);
+    store_row(c + 6 * ldc, c60, c61, va, vb, accumulate);
+    store_row(c + 7 * ldc, c70, c71, va, vb, accumulate);
+}
+
+static const matrix_dgemm_config dgemm_avx512_config = {
+    "avx512", dgemm_ukr_avx512_8x16, AVX512_MR, AVX512_NR, 192, 256, 4080
+};
+
+const matrix_dgemm_config *matrix_dgemm_avx512_config(void) {
+    return &dgemm_avx512_config;
+}
+
+#else
+
+const matrix_dgemm_config *matrix_dgemm_avx512_config(void) {
+    return NULL;
+}
+
+#endif
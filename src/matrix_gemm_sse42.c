@@ -0,0 +1,76 @@
+#include "matrix_internal.h"
+
+// Built with -msse4.2; the fallback for x86 CPUs without AVX2.
+
+#if defined(__SSE4_2__)
+#include <immintrin.h>
+
+#define SSE_MR 4
+#define SSE_NR 4
+
+static inline void store_row(double *c, __m128d lo, __m128d hi, __m128d va, __m128d vb, int accumulate) {
+    lo = _mm_mul_pd(va, lo);
+    hi = _mm_mul_pd(va, hi);
+    if (accumulate) {
+        lo = _mm_add_pd(lo, _mm_mul_pd(vb, _mm_loadu_pd(c)));
+        hi = _mm_add_pd(hi, _mm_mul_pd(vb, _mm_loadu_pd(c + 2)));
+    }
+    _mm_storeu_pd(c, lo);
+    _mm_storeu_pd(c + 2, hi);
+}
+
+// 4x4 tile held in 8 xmm accumulators; no FMA, so each k step is a multiply and
+// an add per accumulator.
+static void dgemm_ukr_sse42_4x4(size_t kc, const double *a, const double *b,
+                                double *c, size_t ldc, double alpha, double beta) {
+    __m128d c00 = _mm_setzero_pd(), c01 = _mm_setzero_pd();
+    __m128d c10 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+    __m128d c20 = _mm_setzero_pd(), c21 = _mm_setzero_pd();
+    __m128d c30 = _mm_setzero_pd(), c31 = _mm_setzero_pd();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m128d b0 = _mm_load_pd(b);
+        __m128d b1 = _mm_load_pd(b + 2);
+        __m128d ai;
+
+        ai = _mm_loaddup_pd(a + 0);
+        c00 = _mm_add_pd(c00, _mm_mul_pd(ai, b0));
+        c01 = _mm_add_pd(c01, _mm_mul_pd(ai, b1));
+        ai = _mm_loaddup_pd(a + 1);
+        c10 = _mm_add_pd(c10, _mm_mul_pd(ai, b0));
+        c11 = _mm_add_pd(c11, _mm_mul_pd(ai, b1));
+        ai = _mm_loaddup_pd(a + 2);
+        c20 = _mm_add_pd(c20, _mm_mul_pd(ai, b0));
+        c21 = _mm_add_pd(c21, _mm_mul_pd(ai, b1));
+        ai = _mm_loaddup_pd(a + 3);
+        c30 = _mm_add_pd(c30, _mm_mul_pd(ai, b0));
+        c31 = _mm_add_pd(c31, _mm_mul_pd(ai, b1));
+
+        a += SSE_MR;
+        b += SSE_NR;
+    }
+
+    __m128d va = _mm_set1_pd(alpha);
+    __m128d vb = _mm_set1_pd(beta);
+    int accumulate = (beta != 0.0);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+}
+
+static const matrix_dgemm_config dgemm_sse42_config = {
+    "sse4.2", dgemm_ukr_sse42_4x4, SSE_MR, SSE_NR, 64, 256, 4096
+};
+
+const matrix_dgemm_config *matrix_dgemm_sse42_config(void) {
+    return &dgemm_sse42_config;
+}
+
+#else
+
+const matrix_dgemm_config *matrix_dgemm_sse42_config(void) {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef MATRIX_INTERNAL_H
+#define MATRIX_INTERNAL_H
+#include "matrix.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// The dense kernels come in double (matrix_d*) and float (matrix_s*) versions with
+// identical contracts; see matrix_real.h for how both are built from one source.
+
+/******* GEMM engine (src/matrix_gemm.c) *******/
+
+// Largest register tile any micro-kernel may use, sizes the edge-tile scratch buffer
+#define MATRIX_GEMM_MAX_MR 16
+#define MATRIX_GEMM_MAX_NR 32
+
+// Micro-kernel: C[0:mr, 0:nr] = alpha * (packed A panel * packed B panel) + beta * C.
+// `a` holds kc columns of mr values, `b` holds kc rows of nr values, both 64-byte aligned.
+// C is never read when beta == 0.
+typedef void (*matrix_dgemm_ukr)(size_t kc, const double *a, const double *b,
+                                 double *c, size_t ldc, double alpha, double beta);
+
+typedef struct {
+    const char *name;
+    matrix_dgemm_ukr kernel;
+    size_t mr, nr;      // register tile
+    size_t mc, kc, nc;  // L2, L1 and L3 blocking of A, the shared dimension and B
+} matrix_dgemm_config;
+
+typedef void (*matrix_sgemm_ukr)(size_t kc, const float *a, const float *b,
+                                 float *c, size_t ldc, float alpha, float beta);
+
+typedef struct {
+    const char *name;
+    matrix_sgemm_ukr kernel;
+    size_t mr, nr;
+    size_t mc, kc, nc;
+} matrix_sgemm_config;
+
+// Micro-kernel variants, one per instruction set. The ISA ones return NULL when
+// the compiler could not build them for this target.
+const matrix_dgemm_config *matrix_dgemm_ref_config(void);
+const matrix_sgemm_config *matrix_sgemm_ref_config(void);
+const matrix_dgemm_config *matrix_dgemm_sse42_config(void);
+const matrix_sgemm_config *matrix_sgemm_sse42_config(void);
+const matrix_dgemm_config *matrix_dgemm_avx2_config(void);
+const matrix_sgemm_config *matrix_sgemm_avx2_config(void);
+const matrix_dgemm_config *matrix_dgemm_avx512_config(void);
+const matrix_sgemm_config *matrix_sgemm_avx512_config(void);
+
+// Row-major C = alpha * op(A) * op(B) + beta * C with op(A) m x k, op(B) k x n and C m x n,
+// where op(X) is X, or X^T with the trans flag (A is then stored k x m, B n x k).
+void matrix_dgemm(bool transa, bool transb, size_t m, size_t n, size_t k, double alpha,
+                  const double *A, size_t lda,
+                  const double *B, size_t ldb,
+                  double beta, double *C, size_t ldc);
+void matrix_sgemm(bool transa, bool transb, size_t m, size_t n, size_t k, float alpha,
+                  const float *A, size_t lda,
+                  const float *B, size_t ldb,
+                  float beta, float *C, size_t ldc);
+
+/******* CPU dispatch (src/matrix_cpu.c) *******/
+
+// One variant of every kernel chosen at run time. A level only replaces the families
+// it improves on and inherits the rest from the level below, so no entry is NULL.
+typedef struct {
+    matrix_isa isa;
+    const matrix_dgemm_config *dgemm;
+    const matrix_sgemm_config *sgemm;
+
+    // Element-wise, on n contiguous values: z = x + s * y (z may be x or y), x *= s, x = v,
+    // and z = x (no overlap). With stream set, add, fill and copy write z with non-temporal
+    // stores, which skip the read-for-ownership of each line: for outputs much larger than
+    // the cache.
+    void (*dadd)(size_t n, const double *x, double s, const double *y, double *z, bool stream);
+    void (*dscal)(size_t n, double s, double *x);
+    void (*dfill)(size_t n, double v, double *x, bool stream);
+    void (*dcopy)(size_t n, const double *x, double *z, bool stream);
+    void (*sadd)(size_t n, const float *x, float s, const float *y, float *z, bool stream);
+    void (*sscal)(size_t n, float s, float *x);
+    void (*sfill)(size_t n, float v, float *x, bool stream);
+
+    // y += s * x, the row update of the LU panel factorization
+    void (*daxpy)(size_t n, double s, const double *x, double *y);
+    void (*saxpy)(size_t n, float s, const float *x, float *y);
+
+    // dst = src^T for a rows x cols block small enough to stay in L1
+    void (*dtranspose)(size_t rows, size_t cols, const double *src, size_t lds, double *dst, size_t ldd);
+    void (*stranspose)(size_t rows, size_t cols, const float *src, size_t lds, float *dst, size_t ldd);
+} matrix_kernels;
+
+// The table in use, resolved once when the library is loaded
+const matrix_kernels *matrix_kernels_get(void);
+
+// Install one instruction set's variants over k; false when they were not compiled in
+bool matrix_kernels_sse42(matrix_kernels *k);
+bool matrix_kernels_avx2(matrix_kernels *k);
+bool matrix_kernels_avx512(matrix_kernels *k);
+
+/******* Triangular solves (src/matrix_trsm.c) *******/
+
+// Solves op(T) X = B in place for an m x m triangular T and an m x n B, where op(T)
+// is T, or T^T with trans. Only the triangle of T selected by `lower` is read; with
+// unit_diag the diagonal is taken as 1.
+void matrix_dtrsm_left(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                       const double *T, size_t ldt, double *B, size_t ldb);
+void matrix_strsm_left(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                       const float *T, size_t ldt, float *B, size_t ldb);
+
+// Solves X op(T) = B in place for an n x n triangular T and an m x n B, with the same
+// conventions; e.g. Cholesky's L21 = A21 * inv(L11)^T without transposing A21.
+void matrix_dtrsm_right(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                        const double *T, size_t ldt, double *B, size_t ldb);
+void matrix_strsm_right(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                        const float *T, size_t ldt, float *B, size_t ldb);
+
+// Inverts the lower or upper triangle of the n x n matrix A in place (non-unit diagonal,
+// which must be non-zero). The other strict triangle is not touched.
+void matrix_dtrtri(bool lower, size_t n, double *A, size_t lda);
+void matrix_strtri(bool lower, size_t n, float *A, size_t lda);
+
+/******* LU factorization (src/matrix_lu.c) *******/
+
+// Blocked LU with partial pivoting of the n x n matrix A, in place: the strict lower
+// triangle receives L's multipliers (unit diagonal implied) and the upper triangle U.
+// Row i was swapped with row ipiv[i], in order. Returns -1 if a pivot is (near) zero.
+int matrix_dgetrf(size_t n, double *A, size_t lda, size_t *ipiv);
+int matrix_sgetrf(size_t n, float *A, size_t lda, size_t *ipiv);
+
+// Overwrites the packed factors produced by matrix_dgetrf with inv(A) (LAPACK getri).
+// Needs one n x 128 scratch buffer. Returns -1 if U is singular or on allocation failure.
+int matrix_dgetri(size_t n, double *A, size_t lda, const size_t *ipiv);
+int matrix_sgetri(size_t n, float *A, size_t lda, const size_t *ipiv);
+
+/******* Cholesky factorization (src/matrix_chol.c) *******/
+
+// Blocked Cholesky A = L * L^T of the n x n matrix A, in place: L overwrites the lower
+// triangle and the strict upper triangle is never read or written. Returns 0 on success,
+// j + 1 if the leading minor of order j + 1 is not positive definite, -1 if out of memory.
+int matrix_dpotrf(size_t n, double *A, size_t lda);
+int matrix_spotrf(size_t n, float *A, size_t lda);
+
+// Overwrites the Cholesky factor in A's lower triangle with the full symmetric inv(A)
+// (LAPACK potri). Returns -1 if L is singular or on allocation failure.
+int matrix_dpotri(size_t n, double *A, size_t lda);
+int matrix_spotri(size_t n, float *A, size_t lda);
+
+/******* Symmetric products (src/matrix_syrk.c) *******/
+
+// One triangle (lower or upper) of C = alpha * op(A) * op(A)^T + beta * C for an n x n C,
+// where op(A) is the n x k A, or A^T with trans (A stored k x n). The other strict triangle
+// is never read or written; C is not read when beta == 0. Returns -1 if out of memory.
+int matrix_dsyrk(bool lower, bool trans, size_t n, size_t k, double alpha,
+                 const double *A, size_t lda, double beta, double *C, size_t ldc);
+int matrix_ssyrk(bool lower, bool trans, size_t n, size_t k, float alpha,
+                 const float *A, size_t lda, float beta, float *C, size_t ldc);
+
+// C = alpha * S * B + beta * C for a symmetric m x m S of which only the lower or upper
+// triangle is read, and m x n B and C. Returns -1 if out of memory.
+int matrix_dsymm(bool lower, size_t m, size_t n, double alpha, const double *S, size_t lds,
+                 const double *B, size_t ldb, double beta, double *C, size_t ldc);
+int matrix_ssymm(bool lower, size_t m, size_t n, float alpha, const float *S, size_t lds,
+                 const float *B, size_t ldb, float beta, float *C, size_t ldc);
+
+// Copies the lower (or upper) triangle of the n x n C over the other one
+void matrix_dsymmetrize(bool lower, size_t n, double *C, size_t ldc);
+void matrix_ssymmetrize(bool lower, size_t n, float *C, size_t ldc);
+
+/******* Complex kernels (src/matrix_zgemm.c, src/matrix_zlu.c) *******/
+
+// Complex double versions, on interleaved (re, im) elements; leading dimensions count
+// complex elements. matrix_zgemm runs 4M or 3M as set by matrix_set_complex_gemm, on
+// opa(A) and opb(B), which may also conjugate.
+void matrix_zgemm(matrix_op opa, matrix_op opb, size_t m, size_t n, size_t k, double _Complex alpha,
+                  const double _Complex *A, size_t lda,
+                  const double _Complex *B, size_t ldb,
+                  double _Complex beta, double _Complex *C, size_t ldc);
+
+// Solves T X = B in place for a lower or upper triangular T (no transposed form)
+void matrix_ztrsm_left(bool lower, bool unit_diag, size_t m, size_t n,
+                       const double _Complex *T, size_t ldt, double _Complex *B, size_t ldb);
+
+// Same packed layout and pivots as matrix_dgetrf. matrix_zgetri solves against the
+// permutation instead of LAPACK's in-place inversion and needs an n x n scratch copy.
+int matrix_zgetrf(size_t n, double _Complex *A, size_t lda, size_t *ipiv);
+int matrix_zgetri(size_t n, double _Complex *A, size_t lda, const size_t *ipiv);
+
+/******* Heap memory (src/matrix_alloc.c) *******/
+
+// Allocate and free through the allocator installed with matrix_set_allocator.
+// matrix_mem_aligned_alloc rounds size up to a multiple of alignment (a power of two).
+void *matrix_mem_alloc(size_t size);
+void *matrix_mem_aligned_alloc(size_t alignment, size_t size);
+void matrix_mem_free(void *ptr);
+
+// Zeroed buffer for matrix data. Large ones may be mapped straight from the kernel
+// (*mapped is set), and must then be released with matrix_mem_data_free.
+void *matrix_mem_data_alloc(size_t size, size_t alignment, bool *mapped);
+void matrix_mem_data_free(void *data, bool mapped);
+
+// Uninitialized buffer for large kernel scratch: refused above the matrix_set_max_allocation
+// cap, otherwise mapped like matrix data. Release it with matrix_mem_data_free too.
+void *matrix_mem_scratch_alloc(size_t size, size_t alignment, bool *mapped);
+
+/******* Scratch memory (src/matrix_arena.c) *******/
+
+// Kernels take their temporaries from the calling thread's arena (see matrix_arena_use)
+// in stack order: begin, any number of allocs, then end, which frees everything
+// allocated since begin. Allocations are 64-byte aligned; NULL means out of memory.
+// Large ones bypass the arena's blocks and are returned to the heap by end.
+typedef struct {
+    matrix_arena *arena;
+    struct matrix_arena_block *block;
+    size_t used;
+    struct matrix_arena_large *large;
+} matrix_scratch_mark;
+
+matrix_scratch_mark matrix_scratch_begin(void);
+void *matrix_scratch_alloc(matrix_scratch_mark mark, size_t bytes);
+void matrix_scratch_end(matrix_scratch_mark mark);
+
+/******* Thread pool (src/matrix_thread.c) *******/
+
+typedef void (*matrix_task_fn)(void *ctx, size_t task);
+
+// Runs fn(ctx, task) for every task in [0, num_tasks) on the library's worker pool and
+// returns when all of them have finished. max_threads caps the threads used (0 = pool size).
+// Calls made from inside a task run serially on the calling thread.
+void matrix_parallel_for(unsigned int max_threads, size_t num_tasks, matrix_task_fn fn, void *ctx);
+
+#endif //MATRIX_INTERNAL_H
@@ -0,0 +1,272 @@
+#include "matrix_internal.h"
+
+// AVX2/FMA variants of the element-wise, transpose and LU panel kernels, built
+// with -mavx2 -mfma. Loops are unrolled to two vectors so loads overlap.
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#include <stdint.h>
+
+static void dadd_avx2(size_t n, const double *x, double s, const double *y, double *z, bool stream) {
+    __m256d vs = _mm256_set1_pd(s);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(z + i) & 31); i++) {
+            z[i] = x[i] + s * y[i];
+        }
+        for (; i + 4 <= n; i += 4) {
+            _mm256_stream_pd(z + i, _mm256_fmadd_pd(vs, _mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+        }
+        _mm_sfence();
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256d z0 = _mm256_fmadd_pd(vs, _mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i));
+        __m256d z1 = _mm256_fmadd_pd(vs, _mm256_loadu_pd(y + i + 4), _mm256_loadu_pd(x + i + 4));
+        _mm256_storeu_pd(z + i, z0);
+        _mm256_storeu_pd(z + i + 4, z1);
+    }
+    for (; i < n; i++) {
+        z[i] = x[i] + s * y[i];
+    }
+}
+
+static void dscal_avx2(size_t n, double s, double *x) {
+    __m256d vs = _mm256_set1_pd(s);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(vs, _mm256_loadu_pd(x + i)));
+        _mm256_storeu_pd(x + i + 4, _mm256_mul_pd(vs, _mm256_loadu_pd(x + i + 4)));
+    }
+    for (; i < n; i++) {
+        x[i] *= s;
+    }
+}
+
+static void dfill_avx2(size_t n, double v, double *x, bool stream) {
+    __m256d vv = _mm256_set1_pd(v);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(x + i) & 31); i++) {
+            x[i] = v;
+        }
+        for (; i + 4 <= n; i += 4) {
+            _mm256_stream_pd(x + i, vv);
+        }
+        _mm_sfence();
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_pd(x + i, vv);
+        _mm256_storeu_pd(x + i + 4, vv);
+    }
+    for (; i < n; i++) {
+        x[i] = v;
+    }
+}
+
+static void dcopy_avx2(size_t n, const double *x, double *z, bool stream) {
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(z + i) & 31); i++) {
+            z[i] = x[i];
+        }
+        for (; i + 4 <= n; i += 4) {
+            _mm256_stream_pd(z + i, _mm256_loadu_pd(x + i));
+        }
+        _mm_sfence();
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256d z0 = _mm256_loadu_pd(x + i);
+        __m256d z1 = _mm256_loadu_pd(x + i + 4);
+        _mm256_storeu_pd(z + i, z0);
+        _mm256_storeu_pd(z + i + 4, z1);
+    }
+    for (; i < n; i++) {
+        z[i] = x[i];
+    }
+}
+
+static void sadd_avx2(size_t n, const float *x, float s, const float *y, float *z, bool stream) {
+    __m256 vs = _mm256_set1_ps(s);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(z + i) & 31); i++) {
+            z[i] = x[i] + s * y[i];
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm256_stream_ps(z + i, _mm256_fmadd_ps(vs, _mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i)));
+        }
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m256 z0 = _mm256_fmadd_ps(vs, _mm256_loadu_ps(y + i), _mm256_loadu_ps(x + i));
+        __m256 z1 = _mm256_fmadd_ps(vs, _mm256_loadu_ps(y + i + 8), _mm256_loadu_ps(x + i + 8));
+        _mm256_storeu_ps(z + i, z0);
+        _mm256_storeu_ps(z + i + 8, z1);
+    }
+    for (; i < n; i++) {
+        z[i] = x[i] + s * y[i];
+    }
+}
+
+static void sscal_avx2(size_t n, float s, float *x) {
+    __m256 vs = _mm256_set1_ps(s);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(vs, _mm256_loadu_ps(x + i)));
+        _mm256_storeu_ps(x + i + 8, _mm256_mul_ps(vs, _mm256_loadu_ps(x + i + 8)));
+    }
+    for (; i < n; i++) {
+        x[i] *= s;
+    }
+}
+
+static void sfill_avx2(size_t n, float v, float *x, bool stream) {
+    __m256 vv = _mm256_set1_ps(v);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(x + i) & 31); i++) {
+            x[i] = v;
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm256_stream_ps(x + i, vv);
+        }
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm256_storeu_ps(x + i, vv);
+        _mm256_storeu_ps(x + i + 8, vv);
+    }
+    for (; i < n; i++) {
+        x[i] = v;
+    }
+}
+
+static void daxpy_avx2(size_t n, double s, const double *x, double *y) {
+    __m256d vs = _mm256_set1_pd(s);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d y0 = _mm256_fmadd_pd(vs, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        __m256d y1 = _mm256_fmadd_pd(vs, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+    }
+    for (; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+static void saxpy_avx2(size_t n, float s, const float *x, float *y) {
+    __m256 vs = _mm256_set1_ps(s);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 y0 = _mm256_fmadd_ps(vs, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i));
+        __m256 y1 = _mm256_fmadd_ps(vs, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8));
+        _mm256_storeu_ps(y + i, y0);
+        _mm256_storeu_ps(y + i + 8, y1);
+    }
+    for (; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+// 4x4 tiles: pair up rows with unpacks, then swap 128-bit halves across the pairs
+static void dtranspose_avx2(size_t rows, size_t cols, const double *src, size_t lds,
+                            double *dst, size_t ldd) {
+    size_t i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const double *s = src + i * lds;
+        size_t j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            __m256d r0 = _mm256_loadu_pd(s + j);
+            __m256d r1 = _mm256_loadu_pd(s + lds + j);
+            __m256d r2 = _mm256_loadu_pd(s + 2 * lds + j);
+            __m256d r3 = _mm256_loadu_pd(s + 3 * lds + j);
+            __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+            __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+            __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+            __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+            double *d = dst + j * ldd + i;
+            _mm256_storeu_pd(d, _mm256_permute2f128_pd(t0, t2, 0x20));
+            _mm256_storeu_pd(d + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+            _mm256_storeu_pd(d + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+            _mm256_storeu_pd(d + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+        }
+        for (; j < cols; j++) {
+            for (size_t r = 0; r < 4; r++) {
+                dst[j * ldd + i + r] = s[r * lds + j];
+            }
+        }
+    }
+    for (; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+// 8x8 float tiles: unpack row pairs, shuffle into quads, then swap 128-bit halves
+static void stranspose_avx2(size_t rows, size_t cols, const float *src, size_t lds,
+                            float *dst, size_t ldd) {
+    size_t i = 0;
+    for (; i + 8 <= rows; i += 8) {
+        const float *s = src + i * lds;
+        size_t j = 0;
+        for (; j + 8 <= cols; j += 8) {
+            __m256 row[8], t[8], q[8];
+            for (size_t r = 0; r < 8; r++) {
+                row[r] = _mm256_loadu_ps(s + r * lds + j);
+            }
+            for (size_t p = 0; p < 8; p += 2) {
+                t[p] = _mm256_unpacklo_ps(row[p], row[p + 1]);
+                t[p + 1] = _mm256_unpackhi_ps(row[p], row[p + 1]);
+            }
+            for (size_t p = 0; p < 8; p += 4) {
+                q[p] = _mm256_shuffle_ps(t[p], t[p + 2], 0x44);
+                q[p + 1] = _mm256_shuffle_ps(t[p], t[p + 2], 0xee);
+                q[p + 2] = _mm256_shuffle_ps(t[p + 1], t[p + 3], 0x44);
+                q[p + 3] = _mm256_shuffle_ps(t[p + 1], t[p + 3], 0xee);
+            }
+            float *d = dst + j * ldd + i;
+            for (size_t p = 0; p < 4; p++) {
+                _mm256_storeu_ps(d + p * ldd, _mm256_permute2f128_ps(q[p], q[p + 4], 0x20));
+                _mm256_storeu_ps(d + (p + 4) * ldd, _mm256_permute2f128_ps(q[p], q[p + 4], 0x31));
+            }
+        }
+        for (; j < cols; j++) {
+            for (size_t r = 0; r < 8; r++) {
+                dst[j * ldd + i + r] = s[r * lds + j];
+            }
+        }
+    }
+    for (; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+bool matrix_kernels_avx2(matrix_kernels *k) {
+    k->dgemm = matrix_dgemm_avx2_config();
+    k->sgemm = matrix_sgemm_avx2_config();
+    k->dadd = dadd_avx2;
+    k->dscal = dscal_avx2;
+    k->dfill = dfill_avx2;
+    k->dcopy = dcopy_avx2;
+    k->sadd = sadd_avx2;
+    k->sscal = sscal_avx2;
+    k->sfill = sfill_avx2;
+    k->daxpy = daxpy_avx2;
+    k->saxpy = saxpy_avx2;
+    k->dtranspose = dtranspose_avx2;
+    k->stranspose = stranspose_avx2;
+    return true;
+}
+
+#else
+
+bool matrix_kernels_avx2(matrix_kernels *k) {
+    (void)k;
+    return false;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include "matrix_internal.h"
+
+// AVX-512F variants of the element-wise and LU panel kernels, built with -mavx512f
+// -mfma. Tails are handled with masked loads and stores instead of a scalar loop.
+// Transposes keep the AVX2 tiles, which already saturate the cache ports.
+
+#if defined(__AVX512F__) && defined(__FMA__)
+#include <immintrin.h>
+#include <stdint.h>
+
+// Mask of the low n lanes, n < 16
+static inline __mmask16 tail_mask(size_t n) {
+    return (__mmask16)((1u << n) - 1);
+}
+
+// Elements of size bytes before p reaches a 64-byte line, at most n
+static inline size_t lanes_to_line(const void *p, size_t size, size_t n) {
+    size_t head = ((64 - ((uintptr_t)p & 63)) & 63) / size;
+    return (head < n) ? head : n;
+}
+
+static void dadd_avx512(size_t n, const double *x, double s, const double *y, double *z, bool stream) {
+    __m512d vs = _mm512_set1_pd(s);
+    size_t i = 0;
+    if (stream) {
+        size_t head = lanes_to_line(z, sizeof(double), n);
+        if (head) {
+            __mmask8 m = (__mmask8)tail_mask(head);
+            __m512d zi = _mm512_fmadd_pd(vs, _mm512_maskz_loadu_pd(m, y), _mm512_maskz_loadu_pd(m, x));
+            _mm512_mask_storeu_pd(z, m, zi);
+            i = head;
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm512_stream_pd(z + i, _mm512_fmadd_pd(vs, _mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i)));
+        }
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512d z0 = _mm512_fmadd_pd(vs, _mm512_loadu_pd(y + i), _mm512_loadu_pd(x + i));
+        __m512d z1 = _mm512_fmadd_pd(vs, _mm512_loadu_pd(y + i + 8), _mm512_loadu_pd(x + i + 8));
+        _mm512_storeu_pd(z + i, z0);
+        _mm512_storeu_pd(z + i + 8, z1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i < 8) ? (__mmask8)tail_mask(n - i) : 0xff;
+        __m512d zi = _mm512_fmadd_pd(vs, _mm512_maskz_loadu_pd(m, y + i), _mm512_maskz_loadu_pd(m, x + i));
+        _mm512_mask_storeu_pd(z + i, m, zi);
+    }
+}
+
+static void dscal_avx512(size_t n, double s, double *x) {
+    __m512d vs = _mm512_set1_pd(s);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(x + i, _mm512_mul_pd(vs, _mm512_loadu_pd(x + i)));
+        _mm512_storeu_pd(x + i + 8, _mm512_mul_pd(vs, _mm512_loadu_pd(x + i + 8)));
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i < 8) ? (__mmask8)tail_mask(n - i) : 0xff;
+        _mm512_mask_storeu_pd(x + i, m, _mm512_mul_pd(vs, _mm512_maskz_loadu_pd(m, x + i)));
+    }
+}
+
+static void dfill_avx512(size_t n, double v, double *x, bool stream) {
+    __m512d vv = _mm512_set1_pd(v);
+    size_t i = 0;
+    if (stream) {
+        size_t head = lanes_to_line(x, sizeof(double), n);
+        if (head) {
+            _mm512_mask_storeu_pd(x, (__mmask8)tail_mask(head), vv);
+            i = head;
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm512_stream_pd(x + i, vv);
+        }
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_pd(x + i, vv);
+        _mm512_storeu_pd(x + i + 8, vv);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i < 8) ? (__mmask8)tail_mask(n - i) : 0xff;
+        _mm512_mask_storeu_pd(x + i, m, vv);
+    }
+}
+
+static void dcopy_avx512(size_t n, const double *x, double *z, bool stream) {
+    size_t i = 0;
+    if (stream) {
+        size_t head = lanes_to_line(z, sizeof(double), n);
+        if (head) {
+            __mmask8 m = (__mmask8)tail_mask(head);
+            _mm512_mask_storeu_pd(z, m, _mm512_maskz_loadu_pd(m, x));
+            i = head;
+        }
+        for (; i + 8 <= n; i += 8) {
+            _mm512_stream_pd(z + i, _mm512_loadu_pd(x + i));
+        }
+        _mm_sfence();
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512d z0 = _mm512_loadu_pd(x + i);
+        __m512d z1 = _mm512_loadu_pd(x + i + 8);
+        _mm512_storeu_pd(z + i, z0);
+        _mm512_storeu_pd(z + i + 8, z1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i < 8) ? (__mmask8)tail_mask(n - i) : 0xff;
+        _mm512_mask_storeu_pd(z + i, m, _mm512_maskz_loadu_pd(m, x + i));
+    }
+}
+
+static void sadd_avx512(size_t n, const float *x, float s, const float *y, float *z, bool stream) {
+    __m512 vs = _mm512_set1_ps(s);
+    size_t i = 0;
+    if (stream) {
+        size_t head = lanes_to_line(z, sizeof(float), n);
+        if (head) {
+            __mmask16 m = tail_mask(head);
+            __m512 zi = _mm512_fmadd_ps(vs, _mm512_maskz_loadu_ps(m, y), _mm512_maskz_loadu_ps(m, x));
+            _mm512_mask_storeu_ps(z, m, zi);
+            i = head;
+        }
+        for (; i + 16 <= n; i += 16) {
+            _mm512_stream_ps(z + i, _mm512_fmadd_ps(vs, _mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i)));
+        }
+        _mm_sfence();
+    }
+    for (; i + 32 <= n; i += 32) {
+        __m512 z0 = _mm512_fmadd_ps(vs, _mm512_loadu_ps(y + i), _mm512_loadu_ps(x + i));
+        __m512 z1 = _mm512_fmadd_ps(vs, _mm512_loadu_ps(y + i + 16), _mm512_loadu_ps(x + i + 16));
+        _mm512_storeu_ps(z + i, z0);
+        _mm512_storeu_ps(z + i + 16, z1);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = (n - i < 16) ? tail_mask(n - i) : 0xffff;
+        __m512 zi = _mm512_fmadd_ps(vs, _mm512_maskz_loadu_ps(m, y + i), _mm512_maskz_loadu_ps(m, x + i));
+        _mm512_mask_storeu_ps(z + i, m, zi);
+    }
+}
+
+static void sscal_avx512(size_t n, float s, float *x) {
+    __m512 vs = _mm512_set1_ps(s);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        _mm512_storeu_ps(x + i, _mm512_mul_ps(vs, _mm512_loadu_ps(x + i)));
+        _mm512_storeu_ps(x + i + 16, _mm512_mul_ps(vs, _mm512_loadu_ps(x + i + 16)));
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = (n - i < 16) ? tail_mask(n - i) : 0xffff;
+        _mm512_mask_storeu_ps(x + i, m, _mm512_mul_ps(vs, _mm512_maskz_loadu_ps(m, x + i)));
+    }
+}
+
+static void sfill_avx512(size_t n, float v, float *x, bool stream) {
+    __m512 vv = _mm512_set1_ps(v);
+    size_t i = 0;
+    if (stream) {
+        size_t head = lanes_to_line(x, sizeof(float), n);
+        if (head) {
+            _mm512_mask_storeu_ps(x, tail_mask(head), vv);
+            i = head;
+        }
+        for (; i + 16 <= n; i += 16) {
+            _mm512_stream_ps(x + i, vv);
+        }
+        _mm_sfence();
+    }
+    for (; i + 32 <= n; i += 32) {
+        _mm512_storeu_ps(x + i, vv);
+        _mm512_storeu_ps(x + i + 16, vv);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = (n - i < 16) ? tail_mask(n - i) : 0xffff;
+        _mm512_mask_storeu_ps(x + i, m, vv);
+    }
+}
+
+static void daxpy_avx512(size_t n, double s, const double *x, double *y) {
+    __m512d vs = _mm512_set1_pd(s);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d y0 = _mm512_fmadd_pd(vs, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        __m512d y1 = _mm512_fmadd_pd(vs, _mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8));
+        _mm512_storeu_pd(y + i, y0);
+        _mm512_storeu_pd(y + i + 8, y1);
+    }
+    for (; i < n; i += 8) {
+        __mmask8 m = (n - i < 8) ? (__mmask8)tail_mask(n - i) : 0xff;
+        __m512d yi = _mm512_fmadd_pd(vs, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, yi);
+    }
+}
+
+static void saxpy_avx512(size_t n, float s, const float *x, float *y) {
+    __m512 vs = _mm512_set1_ps(s);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 y0 = _mm512_fmadd_ps(vs, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i));
+        __m512 y1 = _mm512_fmadd_ps(vs, _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16));
+        _mm512_storeu_ps(y + i, y0);
+        _mm512_storeu_ps(y + i + 16, y1);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 m = (n - i < 16) ? tail_mask(n - i) : 0xffff;
+        __m512 yi = _mm512_fmadd_ps(vs, _mm512_maskz_loadu_ps(m, x + i), _mm512_maskz_loadu_ps(m, y + i));
+        _mm512_mask_storeu_ps(y + i, m, yi);
+    }
+}
+
+bool matrix_kernels_avx512(matrix_kernels *k) {
+    k->dgemm = matrix_dgemm_avx512_config();
+    k->sgemm = matrix_sgemm_avx512_config();
+    k->dadd = dadd_avx512;
+    k->dscal = dscal_avx512;
+    k->dfill = dfill_avx512;
+    k->dcopy = dcopy_avx512;
+    k->sadd = sadd_avx512;
+    k->sscal = sscal_avx512;
+    k->sfill = sfill_avx512;
+    k->daxpy = daxpy_avx512;
+    k->saxpy = saxpy_avx512;
+    return true;
+}
+
+#else
+
+bool matrix_kernels_avx512(matrix_kernels *k) {
+    (void)k;
+    return false;
+}
+
+#endif
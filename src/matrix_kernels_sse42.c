@@ -0,0 +1,195 @@
+#include "matrix_internal.h"
+
+// SSE4.2 variants of the element-wise, transpose and LU panel kernels, built with
+// -msse4.2. Two doubles or four floats per instruction, no FMA. The float element-wise
+// loops are left to the portable versions, which the compiler already turns into SSE.
+
+#if defined(__SSE4_2__)
+#include <immintrin.h>
+#include <stdint.h>
+
+static void dadd_sse42(size_t n, const double *x, double s, const double *y, double *z, bool stream) {
+    __m128d vs = _mm_set1_pd(s);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(z + i) & 15); i++) {
+            z[i] = x[i] + s * y[i];
+        }
+        for (; i + 2 <= n; i += 2) {
+            _mm_stream_pd(z + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(vs, _mm_loadu_pd(y + i))));
+        }
+        _mm_sfence();
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128d z0 = _mm_add_pd(_mm_loadu_pd(x + i), _mm_mul_pd(vs, _mm_loadu_pd(y + i)));
+        __m128d z1 = _mm_add_pd(_mm_loadu_pd(x + i + 2), _mm_mul_pd(vs, _mm_loadu_pd(y + i + 2)));
+        _mm_storeu_pd(z + i, z0);
+        _mm_storeu_pd(z + i + 2, z1);
+    }
+    for (; i < n; i++) {
+        z[i] = x[i] + s * y[i];
+    }
+}
+
+static void dscal_sse42(size_t n, double s, double *x) {
+    __m128d vs = _mm_set1_pd(s);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_pd(x + i, _mm_mul_pd(vs, _mm_loadu_pd(x + i)));
+        _mm_storeu_pd(x + i + 2, _mm_mul_pd(vs, _mm_loadu_pd(x + i + 2)));
+    }
+    for (; i < n; i++) {
+        x[i] *= s;
+    }
+}
+
+static void dfill_sse42(size_t n, double v, double *x, bool stream) {
+    __m128d vv = _mm_set1_pd(v);
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(x + i) & 15); i++) {
+            x[i] = v;
+        }
+        for (; i + 2 <= n; i += 2) {
+            _mm_stream_pd(x + i, vv);
+        }
+        _mm_sfence();
+    }
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_pd(x + i, vv);
+        _mm_storeu_pd(x + i + 2, vv);
+    }
+    for (; i < n; i++) {
+        x[i] = v;
+    }
+}
+
+static void dcopy_sse42(size_t n, const double *x, double *z, bool stream) {
+    size_t i = 0;
+    if (stream) {
+        for (; i < n && ((uintptr_t)(z + i) & 15); i++) {
+            z[i] = x[i];
+        }
+        for (; i + 2 <= n; i += 2) {
+            _mm_stream_pd(z + i, _mm_loadu_pd(x + i));
+        }
+        _mm_sfence();
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m128d z0 = _mm_loadu_pd(x + i);
+        __m128d z1 = _mm_loadu_pd(x + i + 2);
+        _mm_storeu_pd(z + i, z0);
+        _mm_storeu_pd(z + i + 2, z1);
+    }
+    for (; i < n; i++) {
+        z[i] = x[i];
+    }
+}
+
+static void daxpy_sse42(size_t n, double s, const double *x, double *y) {
+    __m128d vs = _mm_set1_pd(s);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d y0 = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(vs, _mm_loadu_pd(x + i)));
+        __m128d y1 = _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(vs, _mm_loadu_pd(x + i + 2)));
+        _mm_storeu_pd(y + i, y0);
+        _mm_storeu_pd(y + i + 2, y1);
+    }
+    for (; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+static void saxpy_sse42(size_t n, float s, const float *x, float *y) {
+    __m128 vs = _mm_set1_ps(s);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 y0 = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(vs, _mm_loadu_ps(x + i)));
+        __m128 y1 = _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(vs, _mm_loadu_ps(x + i + 4)));
+        _mm_storeu_ps(y + i, y0);
+        _mm_storeu_ps(y + i + 4, y1);
+    }
+    for (; i < n; i++) {
+        y[i] += s * x[i];
+    }
+}
+
+// 2x2 tiles: two row loads, two unpacks, two column stores
+static void dtranspose_sse42(size_t rows, size_t cols, const double *src, size_t lds,
+                             double *dst, size_t ldd) {
+    size_t i = 0;
+    for (; i + 2 <= rows; i += 2) {
+        const double *s = src + i * lds;
+        size_t j = 0;
+        for (; j + 2 <= cols; j += 2) {
+            __m128d r0 = _mm_loadu_pd(s + j);
+            __m128d r1 = _mm_loadu_pd(s + lds + j);
+            _mm_storeu_pd(dst + j * ldd + i, _mm_unpacklo_pd(r0, r1));
+            _mm_storeu_pd(dst + (j + 1) * ldd + i, _mm_unpackhi_pd(r0, r1));
+        }
+        for (; j < cols; j++) {
+            dst[j * ldd + i] = s[j];
+            dst[j * ldd + i + 1] = s[lds + j];
+        }
+    }
+    for (; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+// 4x4 float tiles with the classic unpack and move-half sequence
+static void stranspose_sse42(size_t rows, size_t cols, const float *src, size_t lds,
+                             float *dst, size_t ldd) {
+    size_t i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const float *s = src + i * lds;
+        size_t j = 0;
+        for (; j + 4 <= cols; j += 4) {
+            __m128 r0 = _mm_loadu_ps(s + j);
+            __m128 r1 = _mm_loadu_ps(s + lds + j);
+            __m128 r2 = _mm_loadu_ps(s + 2 * lds + j);
+            __m128 r3 = _mm_loadu_ps(s + 3 * lds + j);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            float *d = dst + j * ldd + i;
+            _mm_storeu_ps(d, r0);
+            _mm_storeu_ps(d + ldd, r1);
+            _mm_storeu_ps(d + 2 * ldd, r2);
+            _mm_storeu_ps(d + 3 * ldd, r3);
+        }
+        for (; j < cols; j++) {
+            for (size_t r = 0; r < 4; r++) {
+                dst[j * ldd + i + r] = s[r * lds + j];
+            }
+        }
+    }
+    for (; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+bool matrix_kernels_sse42(matrix_kernels *k) {
+    k->dgemm = matrix_dgemm_sse42_config();
+    k->sgemm = matrix_sgemm_sse42_config();
+    k->dadd = dadd_sse42;
+    k->dscal = dscal_sse42;
+    k->dfill = dfill_sse42;
+    k->dcopy = dcopy_sse42;
+    k->daxpy = daxpy_sse42;
+    k->saxpy = saxpy_sse42;
+    k->dtranspose = dtranspose_sse42;
+    k->stranspose = stranspose_sse42;
+    return true;
+}
+
+#else
+
+bool matrix_kernels_sse42(matrix_kernels *k) {
+    (void)k;
+    return false;
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include "matrix_internal.h"
+#include "matrix_real.h"
+#include <tgmath.h>
+#include <string.h>
+
+// Right-looking blocked LU with partial pivoting (LAPACK getrf). Each NB-wide
+// column panel is factored recursively, its row swaps are applied to the rest
+// of the matrix, then U12 comes from a triangular solve and the trailing
+// matrix gets one GEMM update.
+
+#define LU_NB 128
+
+// Panels this narrow are factored column by column.
+#define LU_PANEL_LEAF 16
+
+// Pivots smaller than this are treated as zero, as the original elimination did.
+#define LU_PIVOT_TOL 1e-10
+
+static void swap_row_segment(real *A, size_t lda, size_t r1, size_t r2, size_t c0, size_t c1) {
+    real *a = A + r1 * lda;
+    real *b = A + r2 * lda;
+    for (size_t c = c0; c < c1; c++) {
+        real tmp = a[c];
+        a[c] = b[c];
+        b[c] = tmp;
+    }
+}
+
+// Applies the swaps ipiv[k1..k2) to columns [c0, c1) of A.
+static void laswp(real *A, size_t lda, size_t c0, size_t c1, size_t k1, size_t k2, const size_t *ipiv) {
+    if (c0 >= c1) {
+        return;
+    }
+    for (size_t i = k1; i < k2; i++) {
+        if (ipiv[i] != i) {
+            swap_row_segment(A, lda, i, ipiv[i], c0, c1);
+        }
+    }
+}
+
+// Unblocked LU of an m x n panel (m >= n); pivots are relative to the panel's first row.
+static int getf2(size_t m, size_t n, real *A, size_t lda, size_t *ipiv) {
+    const matrix_kernels *k = matrix_kernels_get();
+    for (size_t j = 0; j < n; j++) {
+        size_t pivot = j;
+        real max = fabs(A[j * lda + j]);
+        for (size_t i = j + 1; i < m; i++) {
+            real v = fabs(A[i * lda + j]);
+            if (v > max) {
+                max = v;
+                pivot = i;
+            }
+        }
+
+        if (max < LU_PIVOT_TOL) {
+            return -1;
+        }
+
+        ipiv[j] = pivot;
+        if (pivot != j) {
+            swap_row_segment(A, lda, j, pivot, 0, n);
+        }
+
+        const real *aj = A + j * lda;
+        for (size_t i = j + 1; i < m; i++) {
+            real *ai = A + i * lda;
+            real mult = ai[j] / aj[j];
+            ai[j] = mult;
+            k->MATRIX_KERNEL(axpy)(n - j - 1, -mult, aj + j + 1, ai + j + 1);
+        }
+    }
+    return 0;
+}
+
+// Recursive panel LU: factor the left half, update and factor the right half.
+static int getrf_panel(size_t m, size_t n, real *A, size_t lda, size_t *ipiv) {
+    if (n <= LU_PANEL_LEAF) {
+        return getf2(m, n, A, lda, ipiv);
+    }
+
+    size_t n1 = n / 2;
+    size_t n2 = n - n1;
+
+    if (getrf_panel(m, n1, A, lda, ipiv) != 0) {
+        return -1;
+    }
+
+    laswp(A, lda, n1, n, 0, n1, ipiv);
+    MATRIX_FN(trsm_left)(true, false, true, n1, n2, A, lda, A + n1, lda);
+    MATRIX_FN(gemm)(false, false, m - n1, n2, n1, -1.0, A + n1 * lda, lda, A + n1, lda,
+                    1.0, A + n1 * lda + n1, lda);
+
+    if (getrf_panel(m - n1, n2, A + n1 * lda + n1, lda, ipiv + n1) != 0) {
+        return -1;
+    }
+
+    for (size_t i = n1; i < n; i++) {
+        ipiv[i] += n1;
+    }
+    laswp(A, lda, 0, n1, n1, n, ipiv);
+    return 0;
+}
+
+int MATRIX_FN(getrf)(size_t n, real *A, size_t lda, size_t *ipiv) {
+    for (size_t j = 0; j < n; j += LU_NB) {
+        size_t nb = (n - j < LU_NB) ? n - j : LU_NB;
+
+        if (getrf_panel(n - j, nb, A + j * lda + j, lda, ipiv + j) != 0) {
+            return -1;
+        }
+        for (size_t i = j; i < j + nb; i++) {
+            ipiv[i] += j;
+        }
+
+        // Bring the columns outside the panel in line with its row swaps
+        laswp(A, lda, 0, j, j, j + nb, ipiv);
+        laswp(A, lda, j + nb, n, j, j + nb, ipiv);
+
+        if (j + nb < n) {
+            size_t rest = n - j - nb;
+            MATRIX_FN(trsm_left)(true, false, true, nb, rest, A + j * lda + j, lda, A + j * lda + j + nb, lda);
+            MATRIX_FN(gemm)(false, false, rest, rest, nb, -1.0,
+                            A + (j + nb) * lda + j, lda,
+                            A + j * lda + j + nb, lda,
+                            1.0, A + (j + nb) * lda + j + nb, lda);
+        }
+    }
+    return 0;
+}
+
+int MATRIX_FN(getri)(size_t n, real *A, size_t lda, const size_t *ipiv) {
+    for (size_t i = 0; i < n; i++) {
+        if (A[i * lda + i] == 0.0) {
+            return -1;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // One n x NB buffer for the L panel being eliminated, reused for every panel
+    size_t ldw = (n < LU_NB) ? n : LU_NB;
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *work = matrix_scratch_alloc(mark, n * ldw * sizeof(real));
+    if (!work) {
+        matrix_scratch_end(mark);
+        return -1;
+    }
+
+    MATRIX_FN(trtri)(false, n, A, lda);
+
+    // Solve inv(A) * L = inv(U) for inv(A), one column panel at a time from the right
+    size_t j = ((n - 1) / LU_NB) * LU_NB;
+    for (;;) {
+        size_t nb = (n - j < LU_NB) ? n - j : LU_NB;
+
+        // Move the panel's multipliers into work, leaving inv(U) alone in A
+        for (size_t i = j; i < n; i++) {
+            real *w = work + i * ldw;
+            real *a = A + i * lda + j;
+            for (size_t c = 0; c < nb; c++) {
+                if (i > j + c) {
+                    w[c] = a[c];
+                    a[c] = 0.0;
+                }
+            }
+        }
+
+        if (j + nb < n) {
+            MATRIX_FN(gemm)(false, false, n, nb, n - j - nb, -1.0, A + j + nb, lda,
+                            work + (j + nb) * ldw, ldw, 1.0, A + j, lda);
+        }
+
+        // A[:, j:j+nb] = A[:, j:j+nb] * inv(L11), L11 unit lower
+        const real *l11 = work + j * ldw;
+        for (size_t i = 0; i < n; i++) {
+            real *row = A + i * lda + j;
+            for (size_t p = nb; p-- > 1;) {
+                const real *l = l11 + p * ldw;
+                real x = row[p];
+                for (size_t c = 0; c < p; c++) {
+                    row[c] -= x * l[c];
+                }
+            }
+        }
+
+        if (j == 0) {
+            break;
+        }
+        j -= LU_NB;
+    }
+    matrix_scratch_end(mark);
+
+    // inv(A) = inv(U) * inv(L) * P: undo the row swaps as column swaps, in reverse
+    for (size_t i = 0; i < n; i++) {
+        real *row = A + i * lda;
+        for (size_t k = n; k-- > 0;) {
+            if (ipiv[k] != k) {
+                real tmp = row[k];
+                row[k] = row[ipiv[k]];
+                row[ipiv[k]] = tmp;
+            }
+        }
+    }
+    return 0;
+}
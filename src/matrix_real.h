@@ -0,0 +1,20 @@
+#ifndef MATRIX_REAL_H
+#define MATRIX_REAL_H
+
+// The dense kernels (GEMM, TRSM, LU, Cholesky) are written once against `real`
+// and compiled once per element type: matrix_gemm.c and friends build the double
+// versions (matrix_dgemm, ...), and each *_f32.c twin defines MATRIX_REAL_F32 and
+// includes its sibling to build the float ones (matrix_sgemm, ...). MATRIX_KERNEL
+// names the matching entry of the dispatch table (dgemm or sgemm, ...).
+
+#ifdef MATRIX_REAL_F32
+typedef float real;
+#define MATRIX_FN(name) matrix_s##name
+#define MATRIX_KERNEL(name) s##name
+#else
+typedef double real;
+#define MATRIX_FN(name) matrix_d##name
+#define MATRIX_KERNEL(name) d##name
+#endif
+
+#endif //MATRIX_REAL_H
@@ -0,0 +1,89 @@
+#include "matrix_internal.h"
+
+// Built with -mavx2 -mfma; only selected at run time on CPUs that report both.
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+#define AVX2_MR 6
+#define AVX2_NR 16
+
+static inline void store_row(float *c, __m256 lo, __m256 hi, __m256 va, __m256 vb, int accumulate) {
+    lo = _mm256_mul_ps(va, lo);
+    hi = _mm256_mul_ps(va, hi);
+    if (accumulate) {
+        lo = _mm256_fmadd_ps(vb, _mm256_loadu_ps(c), lo);
+        hi = _mm256_fmadd_ps(vb, _mm256_loadu_ps(c + 8), hi);
+    }
+    _mm256_storeu_ps(c, lo);
+    _mm256_storeu_ps(c + 8, hi);
+}
+
+// 6x16 tile held in 12 ymm accumulators, the float twin of the 6x8 double kernel:
+// each k step broadcasts 6 values of A against two vectors of B.
+static void sgemm_ukr_avx2_6x16(size_t kc, const float *a, const float *b,
+                                float *c, size_t ldc, float alpha, float beta) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    __m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+    __m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        __m256 ai;
+
+        _mm_prefetch((const char *)(b + 8 * AVX2_NR), _MM_HINT_T0);
+
+        ai = _mm256_broadcast_ss(a + 0);
+        c00 = _mm256_fmadd_ps(ai, b0, c00);
+        c01 = _mm256_fmadd_ps(ai, b1, c01);
+        ai = _mm256_broadcast_ss(a + 1);
+        c10 = _mm256_fmadd_ps(ai, b0, c10);
+        c11 = _mm256_fmadd_ps(ai, b1, c11);
+        ai = _mm256_broadcast_ss(a + 2);
+        c20 = _mm256_fmadd_ps(ai, b0, c20);
+        c21 = _mm256_fmadd_ps(ai, b1, c21);
+        ai = _mm256_broadcast_ss(a + 3);
+        c30 = _mm256_fmadd_ps(ai, b0, c30);
+        c31 = _mm256_fmadd_ps(ai, b1, c31);
+        ai = _mm256_broadcast_ss(a + 4);
+        c40 = _mm256_fmadd_ps(ai, b0, c40);
+        c41 = _mm256_fmadd_ps(ai, b1, c41);
+        ai = _mm256_broadcast_ss(a + 5);
+        c50 = _mm256_fmadd_ps(ai, b0, c50);
+        c51 = _mm256_fmadd_ps(ai, b1, c51);
+
+        a += AVX2_MR;
+        b += AVX2_NR;
+    }
+
+    __m256 va = _mm256_set1_ps(alpha);
+    __m256 vb = _mm256_set1_ps(beta);
+    int accumulate = (beta != 0.0f);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+    store_row(c + 4 * ldc, c40, c41, va, vb, accumulate);
+    store_row(c + 5 * ldc, c50, c51, va, vb, accumulate);
+}
+
+// Same byte footprint per panel as the double kernel: half-size elements, twice the MC
+static const matrix_sgemm_config sgemm_avx2_config = {
+    "avx2", sgemm_ukr_avx2_6x16, AVX2_MR, AVX2_NR, 144, 256, 4080
+};
+
+const matrix_sgemm_config *matrix_sgemm_avx2_config(void) {
+    return &sgemm_avx2_config;
+}
+
+#else
+
+const matrix_sgemm_config *matrix_sgemm_avx2_config(void) {
+    return NULL;
+}
+
+#endif
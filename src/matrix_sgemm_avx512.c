@@ -0,0 +1,98 @@
+#include "matrix_internal.h"
+
+// Built with -mavx512f -mfma; only selected at run time on CPUs that report AVX-512F.
+
+#if defined(__AVX512F__) && defined(__FMA__)
+#include <immintrin.h>
+
+#define AVX512_MR 8
+#define AVX512_NR 32
+
+static inline void store_row(float *c, __m512 lo, __m512 hi, __m512 va, __m512 vb, int accumulate) {
+    lo = _mm512_mul_ps(va, lo);
+    hi = _mm512_mul_ps(va, hi);
+    if (accumulate) {
+        lo = _mm512_fmadd_ps(vb, _mm512_loadu_ps(c), lo);
+        hi = _mm512_fmadd_ps(vb, _mm512_loadu_ps(c + 16), hi);
+    }
+    _mm512_storeu_ps(c, lo);
+    _mm512_storeu_ps(c + 16, hi);
+}
+
+// 8x32 tile held in 16 zmm accumulators, the float twin of the 8x16 double kernel.
+static void sgemm_ukr_avx512_8x32(size_t kc, const float *a, const float *b,
+                                  float *c, size_t ldc, float alpha, float beta) {
+    __m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+    __m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+    __m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+    __m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+    __m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+    __m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+    __m512 c60 = _mm512_setzero_ps(), c61 = _mm512_setzero_ps();
+    __m512 c70 = _mm512_setzero_ps(), c71 = _mm512_setzero_ps();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+        __m512 ai;
+
+        _mm_prefetch((const char *)(b + 8 * AVX512_NR), _MM_HINT_T0);
+
+        ai = _mm512_set1_ps(a[0]);
+        c00 = _mm512_fmadd_ps(ai, b0, c00);
+        c01 = _mm512_fmadd_ps(ai, b1, c01);
+        ai = _mm512_set1_ps(a[1]);
+        c10 = _mm512_fmadd_ps(ai, b0, c10);
+        c11 = _mm512_fmadd_ps(ai, b1, c11);
+        ai = _mm512_set1_ps(a[2]);
+        c20 = _mm512_fmadd_ps(ai, b0, c20);
+        c21 = _mm512_fmadd_ps(ai, b1, c21);
+        ai = _mm512_set1_ps(a[3]);
+        c30 = _mm512_fmadd_ps(ai, b0, c30);
+        c31 = _mm512_fmadd_ps(ai, b1, c31);
+        ai = _mm512_set1_ps(a[4]);
+        c40 = _mm512_fmadd_ps(ai, b0, c40);
+        c41 = _mm512_fmadd_ps(ai, b1, c41);
+        ai = _mm512_set1_ps(a[5]);
+        c50 = _mm512_fmadd_ps(ai, b0, c50);
+        c51 = _mm512_fmadd_ps(ai, b1, c51);
+        ai = _mm512_set1_ps(a[6]);
+        c60 = _mm512_fmadd_ps(ai, b0, c60);
+        c61 = _mm512_fmadd_ps(ai, b1, c61);
+        ai = _mm512_set1_ps(a[7]);
+        c70 = _mm512_fmadd_ps(ai, b0, c70);
+        c71 = _mm512_fmadd_ps(ai, b1, c71);
+
+        a += AVX512_MR;
+        b += AVX512_NR;
+    }
+
+    __m512 va = _mm512_set1_ps(alpha);
+    __m512 vb = _mm512_set1_ps(beta);
+    int accumulate = (beta != 0.0f);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+    store_row(c + 4 * ldc, c40, c41, va, vb, accumulate);
+    store_row(c + 5 * ldc, c50, c51, va, vb, accumulate);
+    store_row(c + 6 * ldc, c60, c61, va, vb, accumulate);
+    store_row(c + 7 * ldc, c70, c71, va, vb, accumulate);
+}
+
+// Same byte footprint per panel as the double kernel: half-size elements, twice the MC
+static const matrix_sgemm_config sgemm_avx512_config = {
+    "avx512", sgemm_ukr_avx512_8x32, AVX512_MR, AVX512_NR, 384, 256, 4064
+};
+
+const matrix_sgemm_config *matrix_sgemm_avx512_config(void) {
+    return &sgemm_avx512_config;
+}
+
+#else
+
+const matrix_sgemm_config *matrix_sgemm_avx512_config(void) {
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "matrix_internal.h"
+
+// Built with -msse4.2; the fallback for x86 CPUs without AVX2.
+
+#if defined(__SSE4_2__)
+#include <immintrin.h>
+
+#define SSE_MR 4
+#define SSE_NR 8
+
+static inline void store_row(float *c, __m128 lo, __m128 hi, __m128 va, __m128 vb, int accumulate) {
+    lo = _mm_mul_ps(va, lo);
+    hi = _mm_mul_ps(va, hi);
+    if (accumulate) {
+        lo = _mm_add_ps(lo, _mm_mul_ps(vb, _mm_loadu_ps(c)));
+        hi = _mm_add_ps(hi, _mm_mul_ps(vb, _mm_loadu_ps(c + 4)));
+    }
+    _mm_storeu_ps(c, lo);
+    _mm_storeu_ps(c + 4, hi);
+}
+
+// 4x8 tile held in 8 xmm accumulators, the float twin of the 4x4 double kernel.
+static void sgemm_ukr_sse42_4x8(size_t kc, const float *a, const float *b,
+                                float *c, size_t ldc, float alpha, float beta) {
+    __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+    __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+    __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+    __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+
+    for (size_t p = 0; p < kc; p++) {
+        __m128 b0 = _mm_load_ps(b);
+        __m128 b1 = _mm_load_ps(b + 4);
+        __m128 ai;
+
+        ai = _mm_set1_ps(a[0]);
+        c00 = _mm_add_ps(c00, _mm_mul_ps(ai, b0));
+        c01 = _mm_add_ps(c01, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(a[1]);
+        c10 = _mm_add_ps(c10, _mm_mul_ps(ai, b0));
+        c11 = _mm_add_ps(c11, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(a[2]);
+        c20 = _mm_add_ps(c20, _mm_mul_ps(ai, b0));
+        c21 = _mm_add_ps(c21, _mm_mul_ps(ai, b1));
+        ai = _mm_set1_ps(a[3]);
+        c30 = _mm_add_ps(c30, _mm_mul_ps(ai, b0));
+        c31 = _mm_add_ps(c31, _mm_mul_ps(ai, b1));
+
+        a += SSE_MR;
+        b += SSE_NR;
+    }
+
+    __m128 va = _mm_set1_ps(alpha);
+    __m128 vb = _mm_set1_ps(beta);
+    int accumulate = (beta != 0.0f);
+    store_row(c + 0 * ldc, c00, c01, va, vb, accumulate);
+    store_row(c + 1 * ldc, c10, c11, va, vb, accumulate);
+    store_row(c + 2 * ldc, c20, c21, va, vb, accumulate);
+    store_row(c + 3 * ldc, c30, c31, va, vb, accumulate);
+}
+
+static const matrix_sgemm_config sgemm_sse42_config = {
+    "sse4.2", sgemm_ukr_sse42_4x8, SSE_MR, SSE_NR, 128, 256, 4096
+};
+
+const matrix_sgemm_config *matrix_sgemm_sse42_config(void) {
+    return &sgemm_sse42_config;
+}
+
+#else
+
+const matrix_sgemm_config *matrix_sgemm_sse42_config(void) {
+    return NULL;
+}
+
+#endif
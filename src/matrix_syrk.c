@@ -0,0 +1,139 @@
+#include "matrix_internal.h"
+#include "matrix_real.h"
+
+// Symmetric products that touch one triangle. SYRK forms one triangle of
+// alpha * op(A) * op(A)^T + beta * C, half the flops of the full GEMM; SYMM
+// multiplies by a symmetric matrix of which only one triangle is stored. Both
+// walk C in block rows and hand every block to the GEMM engine, which packs the
+// transposed operands in place and spreads each call over the pool.
+
+// SYRK's diagonal blocks are computed whole, so they stay small; SYMM repacks B for
+// every block row, so its rows are taller (256 matched GEMM, 128 ran 30% behind)
+#define SYRK_NB 128
+#define SYMM_NB 256
+#define MIRROR_TILE 32
+
+// Row i of op(A) for an n x k op(A): a row of A, or a column of the k x n A^T
+static const real *op_row(bool trans, const real *A, size_t lda, size_t i) {
+    return trans ? A + i : A + i * lda;
+}
+
+int MATRIX_FN(syrk)(bool lower, bool trans, size_t n, size_t k, real alpha,
+                    const real *A, size_t lda, real beta, real *C, size_t ldc) {
+    if (n == 0) {
+        return 0;
+    }
+    if (k == 0 || alpha == 0.0) {
+        for (size_t i = 0; i < n; i++) {
+            size_t j0 = lower ? 0 : i, j1 = lower ? i + 1 : n;
+            for (size_t j = j0; j < j1; j++) {
+                C[i * ldc + j] = (beta == 0.0) ? 0.0 : beta * C[i * ldc + j];
+            }
+        }
+        return 0;
+    }
+
+    // One diagonal tile, reused for every block row
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *tile = matrix_scratch_alloc(mark, SYRK_NB * SYRK_NB * sizeof(real));
+    if (!tile) {
+        matrix_scratch_end(mark);
+        return -1;
+    }
+
+    for (size_t i0 = 0; i0 < n; i0 += SYRK_NB) {
+        size_t ib = (n - i0 < SYRK_NB) ? n - i0 : SYRK_NB;
+        size_t i1 = i0 + ib;
+        const real *a = op_row(trans, A, lda, i0);
+
+        // The rectangle left (lower) or right (upper) of the diagonal block
+        size_t j0 = lower ? 0 : i1, nj = lower ? i0 : n - i1;
+        if (nj > 0) {
+            MATRIX_FN(gemm)(trans, !trans, ib, nj, k, alpha, a, lda, op_row(trans, A, lda, j0), lda,
+                            beta, C + i0 * ldc + j0, ldc);
+        }
+
+        // The diagonal block goes through the tile so the other triangle is left alone
+        MATRIX_FN(gemm)(trans, !trans, ib, ib, k, alpha, a, lda, a, lda, 0.0, tile, SYRK_NB);
+        for (size_t i = 0; i < ib; i++) {
+            real *c = C + (i0 + i) * ldc + i0;
+            const real *t = tile + i * SYRK_NB;
+            size_t jb = lower ? 0 : i, je = lower ? i + 1 : ib;
+            for (size_t j = jb; j < je; j++) {
+                c[j] = (beta == 0.0) ? t[j] : t[j] + beta * c[j];
+            }
+        }
+    }
+    matrix_scratch_end(mark);
+    return 0;
+}
+
+int MATRIX_FN(symm)(bool lower, size_t m, size_t n, real alpha, const real *S, size_t lds,
+                    const real *B, size_t ldb, real beta, real *C, size_t ldc) {
+    if (m == 0 || n == 0) {
+        return 0;
+    }
+
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    real *tile = matrix_scratch_alloc(mark, SYMM_NB * SYMM_NB * sizeof(real));
+    if (!tile) {
+        matrix_scratch_end(mark);
+        return -1;
+    }
+
+    for (size_t i0 = 0; i0 < m; i0 += SYMM_NB) {
+        size_t ib = (m - i0 < SYMM_NB) ? m - i0 : SYMM_NB;
+        size_t i1 = i0 + ib;
+        real *c = C + i0 * ldc;
+
+        // Diagonal block, expanded from its stored triangle; it also applies beta
+        for (size_t i = 0; i < ib; i++) {
+            for (size_t j = 0; j <= i; j++) {
+                size_t r = lower ? i : j, q = lower ? j : i;
+                real v = S[(i0 + r) * lds + i0 + q];
+                tile[i * SYMM_NB + j] = v;
+                tile[j * SYMM_NB + i] = v;
+            }
+        }
+        MATRIX_FN(gemm)(false, false, ib, n, ib, alpha, tile, SYMM_NB, B + i0 * ldb, ldb, beta, c, ldc);
+
+        // S[i0:i1, 0:i0] and S[i0:i1, i1:m]: read directly on the stored side, and as
+        // the transpose of the block across the diagonal on the other
+        if (i0 > 0) {
+            const real *s = lower ? S + i0 * lds : S + i0;
+            MATRIX_FN(gemm)(!lower, false, ib, n, i0, alpha, s, lds, B, ldb, 1.0, c, ldc);
+        }
+        if (i1 < m) {
+            const real *s = lower ? S + i1 * lds + i0 : S + i0 * lds + i1;
+            MATRIX_FN(gemm)(lower, false, ib, n, m - i1, alpha, s, lds, B + i1 * ldb, ldb, 1.0, c, ldc);
+        }
+    }
+    matrix_scratch_end(mark);
+    return 0;
+}
+
+void MATRIX_FN(symmetrize)(bool lower, size_t n, real *C, size_t ldc) {
+    const matrix_kernels *kern = matrix_kernels_get();
+    for (size_t i0 = 0; i0 < n; i0 += MIRROR_TILE) {
+        size_t ib = (n - i0 < MIRROR_TILE) ? n - i0 : MIRROR_TILE;
+
+        // Whole tiles off the diagonal are transposed across it
+        for (size_t j0 = 0; j0 < i0; j0 += MIRROR_TILE) {
+            real *below = C + i0 * ldc + j0, *above = C + j0 * ldc + i0;
+            if (lower) {
+                kern->MATRIX_KERNEL(transpose)(ib, MIRROR_TILE, below, ldc, above, ldc);
+            } else {
+                kern->MATRIX_KERNEL(transpose)(MIRROR_TILE, ib, above, ldc, below, ldc);
+            }
+        }
+        for (size_t i = i0; i < i0 + ib; i++) {
+            for (size_t j = i0; j < i; j++) {
+                if (lower) {
+                    C[j * ldc + i] = C[i * ldc + j];
+                } else {
+                    C[i * ldc + j] = C[j * ldc + i];
+                }
+            }
+        }
+    }
+}
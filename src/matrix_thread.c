@@ -0,0 +1,204 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Persistent worker pool. Workers are spawned on the first parallel call and
+// then sleep on a condition variable between jobs, so short calls only pay a
+// wake-up. The calling thread always takes part in the work as thread 0.
+
+#define MATRIX_MAX_THREADS 256
+
+typedef struct {
+    matrix_task_fn fn;
+    void *ctx;
+    size_t num_tasks;
+    atomic_size_t next_task;
+    unsigned int num_threads; // including the caller
+} pool_job;
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t workers[MATRIX_MAX_THREADS];
+    unsigned int num_workers;  // spawned so far
+    unsigned int num_threads;  // configured, including the caller
+    unsigned long generation;  // bumped once per job
+    unsigned int running;      // workers still busy with the current job
+    bool busy;
+    bool shutdown;
+    pool_job job;
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static _Thread_local bool in_parallel_region = false;
+
+static unsigned int default_num_threads(void) {
+    const char *env = getenv("MATRIX_NUM_THREADS");
+    if (env && *env) {
+        char *end;
+        long n = strtol(env, &end, 10);
+        if (*end == '\0' && n > 0) {
+            return (n > MATRIX_MAX_THREADS) ? MATRIX_MAX_THREADS : (unsigned int)n;
+        }
+        fprintf(stderr, "Ignoring invalid MATRIX_NUM_THREADS value \"%s\".\n", env);
+    }
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        return 1;
+    }
+    return (ncpu > MATRIX_MAX_THREADS) ? MATRIX_MAX_THREADS : (unsigned int)ncpu;
+}
+
+static void pool_shutdown(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.shutdown = true;
+    pthread_cond_broadcast(&pool.wake);
+    unsigned int num_workers = pool.num_workers;
+    pthread_mutex_unlock(&pool.lock);
+
+    for (unsigned int i = 0; i < num_workers; i++) {
+        pthread_join(pool.workers[i], NULL);
+    }
+}
+
+static void pool_init(void) {
+    pthread_mutex_lock(&pool.lock);
+    if (pool.num_threads == 0) {
+        pool.num_threads = default_num_threads();
+    }
+    pthread_mutex_unlock(&pool.lock);
+    atexit(pool_shutdown);
+}
+
+static void run_tasks(pool_job *job) {
+    for (;;) {
+        size_t task = atomic_fetch_add_explicit(&job->next_task, 1, memory_order_relaxed);
+        if (task >= job->num_tasks) {
+            break;
+        }
+        job->fn(job->ctx, task);
+    }
+}
+
+static void *worker_main(void *arg) {
+    unsigned int id = (unsigned int)(uintptr_t)arg; // 1-based, the caller is 0
+    unsigned long seen = 0;
+
+    in_parallel_region = true;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (!pool.shutdown && pool.generation == seen) {
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        }
+        if (pool.shutdown) {
+            break;
+        }
+        seen = pool.generation;
+        if (id >= pool.job.num_threads) {
+            continue; // not needed for this job
+        }
+
+        pthread_mutex_unlock(&pool.lock);
+        run_tasks(&pool.job);
+        pthread_mutex_lock(&pool.lock);
+
+        if (--pool.running == 0) {
+            pthread_cond_signal(&pool.done);
+        }
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+void matrix_set_num_threads(unsigned int num_threads) {
+    pthread_once(&pool_once, pool_init);
+
+    pthread_mutex_lock(&pool.lock);
+    if (num_threads == 0) {
+        pool.num_threads = default_num_threads();
+    } else {
+        pool.num_threads = (num_threads > MATRIX_MAX_THREADS) ? MATRIX_MAX_THREADS : num_threads;
+    }
+    pthread_mutex_unlock(&pool.lock);
+}
+
+unsigned int matrix_get_num_threads(void) {
+    pthread_once(&pool_once, pool_init);
+
+    pthread_mutex_lock(&pool.lock);
+    unsigned int num_threads = pool.num_threads;
+    pthread_mutex_unlock(&pool.lock);
+    return num_threads;
+}
+
+void matrix_parallel_for(unsigned int max_threads, size_t num_tasks, matrix_task_fn fn, void *ctx) {
+    unsigned int num_threads = matrix_get_num_threads();
+    if (max_threads && num_threads > max_threads) {
+        num_threads = max_threads;
+    }
+    if (num_threads > num_tasks) {
+        num_threads = (unsigned int)num_tasks;
+    }
+
+    // Nested calls and calls made while another thread owns the pool run inline
+    if (num_threads <= 1 || in_parallel_region) {
+        for (size_t task = 0; task < num_tasks; task++) {
+            fn(ctx, task);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    if (pool.busy || pool.shutdown) {
+        pthread_mutex_unlock(&pool.lock);
+        for (size_t task = 0; task < num_tasks; task++) {
+            fn(ctx, task);
+        }
+        return;
+    }
+
+    while (pool.num_workers < num_threads - 1) {
+        uintptr_t id = pool.num_workers + 1;
+        if (pthread_create(&pool.workers[pool.num_workers], NULL, worker_main, (void *)id) != 0) {
+            break;
+        }
+        pool.num_workers++;
+    }
+    if (num_threads > pool.num_workers + 1) {
+        num_threads = pool.num_workers + 1;
+    }
+
+    pool.busy = true;
+    pool.job.fn = fn;
+    pool.job.ctx = ctx;
+    pool.job.num_tasks = num_tasks;
+    atomic_store_explicit(&pool.job.next_task, 0, memory_order_relaxed);
+    pool.job.num_threads = num_threads;
+    pool.running = num_threads - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    in_parallel_region = true;
+    run_tasks(&pool.job);
+    in_parallel_region = false;
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running > 0) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pool.busy = false;
+    pthread_mutex_unlock(&pool.lock);
+}
@@ -0,0 +1,360 @@
+#include "matrix_internal.h"
+#include "matrix_real.h"
+
+// Triangular solves with many right-hand sides. The diagonal blocks are solved
+// with row axpys over the right-hand sides and the rest of B is updated with
+// one GEMM per block, so most flops run at GEMM speed.
+
+#define TRSM_NB 64
+
+// Right-hand-side columns per parallel task; columns are independent.
+#define TRSM_COLS_PER_TASK 256
+
+// The triangle actually solved with is op(T) = T or T^T. Its element (i, p) is
+// T[i * rs + p * cs]: (rs, cs) = (ldt, 1) for T itself and (1, ldt) for T^T.
+
+// Solves the nb x nb lower diagonal block of op(T) starting at row i0, in row order.
+static void trsm_lower_block(bool unit_diag, size_t i0, size_t nb, size_t n,
+                             const real *T, size_t rs, size_t cs, real *B, size_t ldb) {
+    for (size_t i = i0; i < i0 + nb; i++) {
+        real *bi = B + i * ldb;
+        for (size_t p = i0; p < i; p++) {
+            real t = T[i * rs + p * cs];
+            const real *bp = B + p * ldb;
+            for (size_t j = 0; j < n; j++) {
+                bi[j] -= t * bp[j];
+            }
+        }
+        if (!unit_diag) {
+            real d = T[i * rs + i * cs];
+            for (size_t j = 0; j < n; j++) {
+                bi[j] /= d;
+            }
+        }
+    }
+}
+
+// Solves the nb x nb upper diagonal block of op(T) starting at row i0, in reverse row order.
+static void trsm_upper_block(bool unit_diag, size_t i0, size_t nb, size_t n,
+                             const real *T, size_t rs, size_t cs, real *B, size_t ldb) {
+    for (size_t i = i0 + nb; i-- > i0;) {
+        real *bi = B + i * ldb;
+        for (size_t p = i + 1; p < i0 + nb; p++) {
+            real t = T[i * rs + p * cs];
+            const real *bp = B + p * ldb;
+            for (size_t j = 0; j < n; j++) {
+                bi[j] -= t * bp[j];
+            }
+        }
+        if (!unit_diag) {
+            real d = T[i * rs + i * cs];
+            for (size_t j = 0; j < n; j++) {
+                bi[j] /= d;
+            }
+        }
+    }
+}
+
+// B[r0:r1] -= op(T)[r0:r1, i0:i0+nb] * B[i0:i0+nb]; GEMM reads T^T straight from T
+static void trsm_update(bool trans, size_t r0, size_t r1, size_t i0, size_t nb, size_t n,
+                        const real *T, size_t ldt, real *B, size_t ldb) {
+    if (r0 < r1) {
+        const real *t = trans ? T + i0 * ldt + r0 : T + r0 * ldt + i0;
+        MATRIX_FN(gemm)(trans, false, r1 - r0, n, nb, -1.0, t, ldt,
+                        B + i0 * ldb, ldb, 1.0, B + r0 * ldb, ldb);
+    }
+}
+
+static void trsm_left_serial(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                             const real *T, size_t ldt, real *B, size_t ldb) {
+    size_t rs = trans ? 1 : ldt;
+    size_t cs = trans ? ldt : 1;
+
+    if (lower != trans) {
+        // Top down: solve a diagonal block, then update every row below it
+        for (size_t i0 = 0; i0 < m; i0 += TRSM_NB) {
+            size_t nb = (m - i0 < TRSM_NB) ? m - i0 : TRSM_NB;
+            trsm_lower_block(unit_diag, i0, nb, n, T, rs, cs, B, ldb);
+            trsm_update(trans, i0 + nb, m, i0, nb, n, T, ldt, B, ldb);
+        }
+    } else {
+        // Bottom up: solve a diagonal block, then update every row above it
+        size_t i1 = m;
+        while (i1 > 0) {
+            size_t nb = (i1 < TRSM_NB) ? i1 : TRSM_NB;
+            size_t i0 = i1 - nb;
+            trsm_upper_block(unit_diag, i0, nb, n, T, rs, cs, B, ldb);
+            trsm_update(trans, 0, i0, i0, nb, n, T, ldt, B, ldb);
+            i1 = i0;
+        }
+    }
+}
+
+typedef struct {
+    bool lower, trans, unit_diag;
+    size_t m, n;
+    const real *T;
+    size_t ldt;
+    real *B;
+    size_t ldb;
+} trsm_job;
+
+static void trsm_left_task(void *ctx, size_t task) {
+    const trsm_job *job = ctx;
+    size_t j0 = task * TRSM_COLS_PER_TASK;
+    size_t cols = (job->n - j0 < TRSM_COLS_PER_TASK) ? job->n - j0 : TRSM_COLS_PER_TASK;
+    trsm_left_serial(job->lower, job->trans, job->unit_diag, job->m, cols,
+                     job->T, job->ldt, job->B + j0, job->ldb);
+}
+
+void MATRIX_FN(trsm_left)(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                          const real *T, size_t ldt, real *B, size_t ldb) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    size_t num_tasks = (n + TRSM_COLS_PER_TASK - 1) / TRSM_COLS_PER_TASK;
+    if (num_tasks == 1) {
+        trsm_left_serial(lower, trans, unit_diag, m, n, T, ldt, B, ldb);
+        return;
+    }
+
+    trsm_job job = { lower, trans, unit_diag, m, n, T, ldt, B, ldb };
+    matrix_parallel_for(0, num_tasks, trsm_left_task, &job);
+}
+
+// Right-side solves X op(T) = B treat every row x of B on its own, x op(T) = b, so
+// tasks split the rows. Column blocks of X are solved in the order op(T) allows, each
+// after one GEMM has removed the blocks already solved.
+
+#define TRSM_ROWS_PER_TASK 256
+
+// Solves columns [j0, j0 + nb) of the m rows of B against the diagonal block of op(T),
+// left to right when op(T) is upper triangular, right to left when it is lower.
+static void trsm_right_block(bool upper, bool unit_diag, size_t j0, size_t nb, size_t m,
+                             const real *T, size_t rs, size_t cs, real *B, size_t ldb) {
+    for (size_t r = 0; r < m; r++) {
+        real *x = B + r * ldb;
+        if (upper) {
+            for (size_t j = j0; j < j0 + nb; j++) {
+                real sum = x[j];
+                for (size_t p = j0; p < j; p++) {
+                    sum -= x[p] * T[p * rs + j * cs];
+                }
+                x[j] = unit_diag ? sum : sum / T[j * rs + j * cs];
+            }
+        } else {
+            for (size_t j = j0 + nb; j-- > j0;) {
+                real sum = x[j];
+                for (size_t p = j + 1; p < j0 + nb; p++) {
+                    sum -= x[p] * T[p * rs + j * cs];
+                }
+                x[j] = unit_diag ? sum : sum / T[j * rs + j * cs];
+            }
+        }
+    }
+}
+
+static void trsm_right_serial(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                              const real *T, size_t ldt, real *B, size_t ldb) {
+    size_t rs = trans ? 1 : ldt;
+    size_t cs = trans ? ldt : 1;
+
+    if (lower == trans) {
+        // Left to right: block [j0, j0 + nb) first loses X[:, 0:j0] * op(T)[0:j0, block]
+        for (size_t j0 = 0; j0 < n; j0 += TRSM_NB) {
+            size_t nb = (n - j0 < TRSM_NB) ? n - j0 : TRSM_NB;
+            if (j0 > 0) {
+                const real *t = trans ? T + j0 * ldt : T + j0;
+                MATRIX_FN(gemm)(false, trans, m, nb, j0, -1.0, B, ldb, t, ldt, 1.0, B + j0, ldb);
+            }
+            trsm_right_block(true, unit_diag, j0, nb, m, T, rs, cs, B, ldb);
+        }
+    } else {
+        // Right to left: block [j0, j1) first loses X[:, j1:n] * op(T)[j1:n, block]
+        size_t j1 = n;
+        while (j1 > 0) {
+            size_t nb = (j1 < TRSM_NB) ? j1 : TRSM_NB;
+            size_t j0 = j1 - nb;
+            if (j1 < n) {
+                const real *t = trans ? T + j0 * ldt + j1 : T + j1 * ldt + j0;
+                MATRIX_FN(gemm)(false, trans, m, nb, n - j1, -1.0, B + j1, ldb, t, ldt, 1.0, B + j0, ldb);
+            }
+            trsm_right_block(false, unit_diag, j0, nb, m, T, rs, cs, B, ldb);
+            j1 = j0;
+        }
+    }
+}
+
+static void trsm_right_task(void *ctx, size_t task) {
+    const trsm_job *job = ctx;
+    size_t i0 = task * TRSM_ROWS_PER_TASK;
+    size_t rows = (job->m - i0 < TRSM_ROWS_PER_TASK) ? job->m - i0 : TRSM_ROWS_PER_TASK;
+    trsm_right_serial(job->lower, job->trans, job->unit_diag, rows, job->n,
+                      job->T, job->ldt, job->B + i0 * job->ldb, job->ldb);
+}
+
+void MATRIX_FN(trsm_right)(bool lower, bool trans, bool unit_diag, size_t m, size_t n,
+                           const real *T, size_t ldt, real *B, size_t ldb) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    size_t num_tasks = (m + TRSM_ROWS_PER_TASK - 1) / TRSM_ROWS_PER_TASK;
+    if (num_tasks == 1) {
+        trsm_right_serial(lower, trans, unit_diag, m, n, T, ldt, B, ldb);
+        return;
+    }
+
+    trsm_job job = { lower, trans, unit_diag, m, n, T, ldt, B, ldb };
+    matrix_parallel_for(0, num_tasks, trsm_right_task, &job);
+}
+
+// Triangular inverse (LAPACK trtri). Each diagonal block is inverted column by
+// column; the off-diagonal blocks are multiplied by the part already inverted
+// (mostly GEMM) and then by the block's own inverse.
+
+#define TRTRI_NB 128
+
+// Inverts the nb x nb upper triangle at A in place, column by column.
+static void trti2_upper(size_t nb, real *A, size_t lda) {
+    for (size_t j = 0; j < nb; j++) {
+        A[j * lda + j] = 1.0 / A[j * lda + j];
+        real ajj = -A[j * lda + j];
+
+        // A[0:j, j] = ajj * inv(U[0:j, 0:j]) * A[0:j, j], top down so each row reads unmodified ones
+        for (size_t i = 0; i < j; i++) {
+            real sum = 0.0;
+            for (size_t p = i; p < j; p++) {
+                sum += A[i * lda + p] * A[p * lda + j];
+            }
+            A[i * lda + j] = ajj * sum;
+        }
+    }
+}
+
+// Inverts the nb x nb lower triangle at A in place, column by column from the right.
+static void trti2_lower(size_t nb, real *A, size_t lda) {
+    for (size_t j = nb; j-- > 0;) {
+        A[j * lda + j] = 1.0 / A[j * lda + j];
+        real ajj = -A[j * lda + j];
+
+        // A[j+1:nb, j] = ajj * inv(L[j+1:nb, j+1:nb]) * A[j+1:nb, j], bottom up
+        for (size_t i = nb; i-- > j + 1;) {
+            real sum = 0.0;
+            for (size_t p = j + 1; p <= i; p++) {
+                sum += A[i * lda + p] * A[p * lda + j];
+            }
+            A[i * lda + j] = ajj * sum;
+        }
+    }
+}
+
+// B = T * B in place for the m x m upper triangle T and an m x n B; rows are
+// processed top down so the GEMM part always reads rows not yet overwritten.
+static void trmm_upper(size_t m, size_t n, const real *T, size_t ldt, real *B, size_t ldb) {
+    for (size_t i0 = 0; i0 < m; i0 += TRTRI_NB) {
+        size_t nb = (m - i0 < TRTRI_NB) ? m - i0 : TRTRI_NB;
+        for (size_t i = i0; i < i0 + nb; i++) {
+            real *bi = B + i * ldb;
+            real t = T[i * ldt + i];
+            for (size_t j = 0; j < n; j++) {
+                bi[j] *= t;
+            }
+            for (size_t p = i + 1; p < i0 + nb; p++) {
+                const real *bp = B + p * ldb;
+                t = T[i * ldt + p];
+                for (size_t j = 0; j < n; j++) {
+                    bi[j] += t * bp[j];
+                }
+            }
+        }
+        if (i0 + nb < m) {
+            MATRIX_FN(gemm)(false, false, nb, n, m - i0 - nb, 1.0, T + i0 * ldt + i0 + nb, ldt,
+                            B + (i0 + nb) * ldb, ldb, 1.0, B + i0 * ldb, ldb);
+        }
+    }
+}
+
+// B = T * B in place for the m x m lower triangle T and an m x n B, bottom up.
+static void trmm_lower(size_t m, size_t n, const real *T, size_t ldt, real *B, size_t ldb) {
+    size_t i1 = m;
+    while (i1 > 0) {
+        size_t nb = (i1 < TRTRI_NB) ? i1 : TRTRI_NB;
+        size_t i0 = i1 - nb;
+        for (size_t i = i1; i-- > i0;) {
+            real *bi = B + i * ldb;
+            real t = T[i * ldt + i];
+            for (size_t j = 0; j < n; j++) {
+                bi[j] *= t;
+            }
+            for (size_t p = i0; p < i; p++) {
+                const real *bp = B + p * ldb;
+                t = T[i * ldt + p];
+                for (size_t j = 0; j < n; j++) {
+                    bi[j] += t * bp[j];
+                }
+            }
+        }
+        if (i0 > 0) {
+            MATRIX_FN(gemm)(false, false, nb, n, i0, 1.0, T + i0 * ldt, ldt, B, ldb, 1.0, B + i0 * ldb, ldb);
+        }
+        i1 = i0;
+    }
+}
+
+void MATRIX_FN(trtri)(bool lower, size_t n, real *A, size_t lda) {
+    if (!lower) {
+        for (size_t j = 0; j < n; j += TRTRI_NB) {
+            size_t nb = (n - j < TRTRI_NB) ? n - j : TRTRI_NB;
+            real *a01 = A + j;
+            real *a11 = A + j * lda + j;
+
+            // A01 = -inv(A00) * A01 * inv(A11), with A00 already inverted
+            trmm_upper(j, nb, A, lda, a01, lda);
+            for (size_t i = 0; i < j; i++) {
+                real *row = a01 + i * lda;
+                for (size_t c = 0; c < nb; c++) {
+                    row[c] = -row[c];
+                }
+                for (size_t c = 0; c < nb; c++) {
+                    const real *u = a11 + c * lda;
+                    real x = row[c] / u[c];
+                    row[c] = x;
+                    for (size_t q = c + 1; q < nb; q++) {
+                        row[q] -= x * u[q];
+                    }
+                }
+            }
+            trti2_upper(nb, a11, lda);
+        }
+        return;
+    }
+
+    size_t j1 = n;
+    while (j1 > 0) {
+        size_t nb = (j1 < TRTRI_NB) ? j1 : TRTRI_NB;
+        size_t j = j1 - nb;
+        real *a11 = A + j * lda + j;
+        real *a21 = A + j1 * lda + j;
+
+        // A21 = -inv(A22) * A21 * inv(A11), with A22 already inverted
+        trmm_lower(n - j1, nb, A + j1 * lda + j1, lda, a21, lda);
+        for (size_t i = 0; i < n - j1; i++) {
+            real *row = a21 + i * lda;
+            for (size_t c = 0; c < nb; c++) {
+                row[c] = -row[c];
+            }
+            for (size_t c = nb; c-- > 0;) {
+                const real *l = a11 + c * lda;
+                real x = row[c] / l[c];
+                row[c] = x;
+                for (size_t q = 0; q < c; q++) {
+                    row[q] -= x * l[q];
+                }
+            }
+        }
+        trti2_lower(nb, a11, lda);
+        j1 = j;
+    }
+}
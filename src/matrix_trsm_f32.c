@@ -0,0 +1,3 @@
+// Single-precision build of matrix_trsm.c, see matrix_real.h
+#define MATRIX_REAL_F32
+#include "matrix_trsm.c"
@@ -0,0 +1,320 @@
+#include "matrix.h"
+#include "matrix_internal.h"
+#include <complex.h>
+
+// Complex GEMM on the real micro-kernels. It runs the same Goto/BLIS loop nest as
+// matrix_dgemm, but the packing step splits every KC x NC panel of B and MC x KC block
+// of A into real and imaginary sub-panels, and the macro-kernel runs the real
+// micro-kernel once per plane product on each register tile and combines the tiles as
+// it updates C = alpha * P + beta * C. Scratch stays at panel size, with no full-size
+// planes, so complex products get the packed SIMD kernels and the thread pool for free.
+//
+// 4M forms P = (Ar Br - Ai Bi) + i (Ar Bi + Ai Br) with four real products. 3M (Gauss)
+// uses three, T1 = Ar Br, T2 = Ai Bi and T3 = (Ar + Ai)(Br + Bi), with P = (T1 - T2) +
+// i (T3 - T1 - T2): a quarter fewer flops, at the price of a larger rounding error in
+// the imaginary part when it is small relative to the real part.
+
+// Below this many complex multiply-adds packing costs more than it saves
+#define ZGEMM_SMALL_FLOPS (32.0 * 32.0 * 32.0)
+
+// Products below this many complex multiply-adds stay on the calling thread
+#define ZGEMM_PARALLEL_FLOPS (64.0 * 64.0 * 64.0)
+
+// Aim for this many compute tiles per thread so uneven tiles still balance
+#define ZGEMM_TILES_PER_THREAD 4
+
+static matrix_complex_gemm complex_gemm = MATRIX_COMPLEX_GEMM_4M;
+
+void matrix_set_complex_gemm(matrix_complex_gemm method) {
+    complex_gemm = method;
+}
+
+// The library's complex elements are double[2] pairs, C99's layout for double _Complex;
+// the kernels work on that layout directly so no multiply goes through libgcc's
+// NaN-recovering __muldc3.
+
+// Strides of op(X)'s rows and columns in complex elements, and the sign of its imaginary part
+typedef struct {
+    size_t rs, cs;
+    double im;
+} zop_layout;
+
+static zop_layout zop(matrix_op op, size_t ldx) {
+    zop_layout l = { ldx, 1, 1.0 };
+    if (op != MATRIX_OP_NONE) {
+        l.rs = 1;
+        l.cs = ldx;
+        l.im = (op == MATRIX_OP_CONJ_TRANS) ? -1.0 : 1.0;
+    }
+    return l;
+}
+
+// Direct i-k-j loop for products too small to amortize packing.
+static void zgemm_small(matrix_op opa, matrix_op opb, size_t m, size_t n, size_t k, double ar, double ai,
+                        const double *A, size_t lda, const double *B, size_t ldb,
+                        double br, double bi, double *C, size_t ldc) {
+    zop_layout la = zop(opa, lda), lb = zop(opb, ldb);
+    for (size_t i = 0; i < m; i++) {
+        double *c = C + 2 * i * ldc;
+        for (size_t j = 0; j < n; j++) {
+            double cr = c[2 * j], ci = c[2 * j + 1];
+            bool zero = (br == 0.0 && bi == 0.0);
+            c[2 * j] = zero ? 0.0 : br * cr - bi * ci;
+            c[2 * j + 1] = zero ? 0.0 : br * ci + bi * cr;
+        }
+        for (size_t p = 0; p < k; p++) {
+            const double *x = A + 2 * (i * la.rs + p * la.cs);
+            double xr = x[0], xi = la.im * x[1];
+            double sr = ar * xr - ai * xi;
+            double si = ar * xi + ai * xr;
+            const double *b = B + 2 * p * lb.rs;
+            for (size_t j = 0; j < n; j++) {
+                const double *y = b + 2 * j * lb.cs;
+                double yr = y[0], yi = lb.im * y[1];
+                c[2 * j] += sr * yr - si * yi;
+                c[2 * j + 1] += sr * yi + si * yr;
+            }
+        }
+    }
+}
+
+// The packed planes of one block: real and imaginary parts, and for 3M their sum
+typedef struct {
+    double *re, *im, *sum;
+} zplanes;
+
+static zplanes zplanes_at(double *buf, size_t plane, bool gauss) {
+    zplanes z = { buf, buf + plane, gauss ? buf + 2 * plane : NULL };
+    return z;
+}
+
+static void zput(const zplanes *z, size_t at, double re, double im) {
+    z->re[at] = re;
+    z->im[at] = im;
+    if (z->sum) {
+        z->sum[at] = re + im;
+    }
+}
+
+// Packs rows [0, mc) and columns [0, kc) of op(A), X pointing at its first element, into
+// mr-row panels of each plane, zero-padding the last panel (matrix_gemm.c's layout).
+static void zpack_a(matrix_op op, size_t mc, size_t kc, const double *X, size_t ldx,
+                    size_t mr, const zplanes *z) {
+    zop_layout l = zop(op, ldx);
+    size_t at = 0;
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t rows = (mc - ir < mr) ? mc - ir : mr;
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t i = 0; i < rows; i++) {
+                const double *x = X + 2 * ((ir + i) * l.rs + p * l.cs);
+                zput(z, at + i, x[0], l.im * x[1]);
+            }
+            for (size_t i = rows; i < mr; i++) {
+                zput(z, at + i, 0.0, 0.0);
+            }
+            at += mr;
+        }
+    }
+}
+
+// Packs rows [0, kc) and columns [0, nc) of op(B) into nr-column panels of each plane.
+static void zpack_b(matrix_op op, size_t kc, size_t nc, const double *X, size_t ldx,
+                    size_t nr, const zplanes *z) {
+    zop_layout l = zop(op, ldx);
+    size_t at = 0;
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = (nc - jr < nr) ? nc - jr : nr;
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t j = 0; j < cols; j++) {
+                const double *x = X + 2 * (p * l.rs + (jr + j) * l.cs);
+                zput(z, at + j, x[0], l.im * x[1]);
+            }
+            for (size_t j = cols; j < nr; j++) {
+                zput(z, at + j, 0.0, 0.0);
+            }
+            at += nr;
+        }
+    }
+}
+
+// State for one KC x NC slab of the product, shared by all worker tasks.
+typedef struct {
+    const matrix_dgemm_config *cfg;
+    matrix_op opa, opb;
+    bool gauss;
+    const double *A, *B;
+    size_t lda, ldb, ldc;
+    double *C;
+    double ar, ai, br, bi;
+    size_t m, nc, kc;
+    size_t mc;          // rows per A block, cfg->mc shared out between the planes
+    size_t num_ic;      // MC row blocks of A and C
+    size_t num_jr;      // column chunks of B and C
+    size_t jr_chunk;    // columns per chunk, a multiple of nr
+    size_t b_plane;     // doubles in one plane of the packed B panel
+    double *packed_b;
+} zgemm_slab;
+
+static void zgemm_pack_task(void *ctx, size_t task) {
+    const zgemm_slab *s = ctx;
+    size_t j0 = task * s->jr_chunk;
+    size_t cols = (s->nc - j0 < s->jr_chunk) ? s->nc - j0 : s->jr_chunk;
+    zop_layout l = zop(s->opb, s->ldb);
+    zplanes z = zplanes_at(s->packed_b, s->b_plane, s->gauss);
+    z.re += j0 * s->kc;
+    z.im += j0 * s->kc;
+    if (z.sum) {
+        z.sum += j0 * s->kc;
+    }
+    zpack_b(s->opb, s->kc, cols, s->B + 2 * j0 * l.cs, s->ldb, s->cfg->nr, &z);
+}
+
+// C = alpha * P + beta * C for one rows x cols tile, P given as its real and imaginary
+// parts (4M) or as T1, T2 and T3 (3M); C is not read when beta == 0
+static void zmerge(size_t rows, size_t cols, size_t nr, bool gauss, const double *t1,
+                   const double *t2, const double *t3, const zgemm_slab *s, double br, double bi,
+                   double *c, size_t ldc) {
+    bool accumulate = (br != 0.0 || bi != 0.0);
+    for (size_t i = 0; i < rows; i++) {
+        double *ci = c + 2 * i * ldc;
+        for (size_t j = 0; j < cols; j++) {
+            size_t at = i * nr + j;
+            double xr = gauss ? t1[at] - t2[at] : t1[at];
+            double xi = gauss ? t3[at] - t1[at] - t2[at] : t2[at];
+            double vr = s->ar * xr - s->ai * xi;
+            double vi = s->ar * xi + s->ai * xr;
+            if (accumulate) {
+                double cr = ci[2 * j], cim = ci[2 * j + 1];
+                vr += br * cr - bi * cim;
+                vi += br * cim + bi * cr;
+            }
+            ci[2 * j] = vr;
+            ci[2 * j + 1] = vi;
+        }
+    }
+}
+
+// One MC x jr_chunk tile of C; A's block is packed into the running thread's arena
+static void zgemm_compute_task(void *ctx, size_t task) {
+    const zgemm_slab *s = ctx;
+    const matrix_dgemm_config *cfg = s->cfg;
+    size_t mr = cfg->mr, nr = cfg->nr, kc = s->kc;
+    size_t ic = (task / s->num_jr) * s->mc;
+    size_t j0 = (task % s->num_jr) * s->jr_chunk;
+    size_t mc = (s->m - ic < s->mc) ? s->m - ic : s->mc;
+    size_t nc = (s->nc - j0 < s->jr_chunk) ? s->nc - j0 : s->jr_chunk;
+    zop_layout la = zop(s->opa, s->lda), lb = zop(s->opb, s->ldb);
+    const double *a = s->A + 2 * ic * la.rs;
+    double *c = s->C + 2 * (ic * s->ldc + j0);
+    double br = s->br, bi = s->bi;
+
+    size_t a_plane = ((mc + mr - 1) / mr) * mr * kc;
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    double *buf = matrix_scratch_alloc(mark, (s->gauss ? 3 : 2) * a_plane * sizeof(double));
+    if (!buf) {
+        // Out of memory for the block: still produce the right answer
+        matrix_scratch_end(mark);
+        zgemm_small(s->opa, s->opb, mc, nc, kc, s->ar, s->ai, a, s->lda, s->B + 2 * j0 * lb.cs, s->ldb,
+                    br, bi, c, s->ldc);
+        return;
+    }
+    zplanes pa = zplanes_at(buf, a_plane, s->gauss);
+    zpack_a(s->opa, mc, kc, a, s->lda, mr, &pa);
+    zplanes pb = zplanes_at(s->packed_b, s->b_plane, s->gauss);
+
+    _Alignas(64) double t1[MATRIX_GEMM_MAX_MR * MATRIX_GEMM_MAX_NR];
+    _Alignas(64) double t2[MATRIX_GEMM_MAX_MR * MATRIX_GEMM_MAX_NR];
+    _Alignas(64) double t3[MATRIX_GEMM_MAX_MR * MATRIX_GEMM_MAX_NR];
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = (nc - jr < nr) ? nc - jr : nr;
+        size_t bo = (j0 + jr) * kc;
+        for (size_t ir = 0; ir < mc; ir += mr) {
+            size_t rows = (mc - ir < mr) ? mc - ir : mr;
+            size_t ao = ir * kc;
+            if (s->gauss) {
+                cfg->kernel(kc, pa.re + ao, pb.re + bo, t1, nr, 1.0, 0.0);
+                cfg->kernel(kc, pa.im + ao, pb.im + bo, t2, nr, 1.0, 0.0);
+                cfg->kernel(kc, pa.sum + ao, pb.sum + bo, t3, nr, 1.0, 0.0);
+            } else {
+                // t1 = Ar Br - Ai Bi and t2 = Ar Bi + Ai Br, accumulated by the kernel
+                cfg->kernel(kc, pa.re + ao, pb.re + bo, t1, nr, 1.0, 0.0);
+                cfg->kernel(kc, pa.im + ao, pb.im + bo, t1, nr, -1.0, 1.0);
+                cfg->kernel(kc, pa.re + ao, pb.im + bo, t2, nr, 1.0, 0.0);
+                cfg->kernel(kc, pa.im + ao, pb.re + bo, t2, nr, 1.0, 1.0);
+            }
+            zmerge(rows, cols, nr, s->gauss, t1, t2, t3, s, br, bi, c + 2 * (ir * s->ldc + jr), s->ldc);
+        }
+    }
+    matrix_scratch_end(mark);
+}
+
+void matrix_zgemm(matrix_op opa, matrix_op opb, size_t m, size_t n, size_t k, double _Complex alpha,
+                  const double _Complex *A, size_t lda,
+                  const double _Complex *B, size_t ldb,
+                  double _Complex beta, double _Complex *C, size_t ldc) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+
+    double ar = creal(alpha), ai = cimag(alpha);
+    double br = creal(beta), bi = cimag(beta);
+    const double *a = (const double *)A;
+    const double *b = (const double *)B;
+    double *c = (double *)C;
+
+    double flops = (double)m * (double)n * (double)k;
+    if (k == 0 || (ar == 0.0 && ai == 0.0) || flops <= ZGEMM_SMALL_FLOPS) {
+        zgemm_small(opa, opb, m, n, (ar == 0.0 && ai == 0.0) ? 0 : k, ar, ai, a, lda, b, ldb, br, bi, c, ldc);
+        return;
+    }
+
+    // Each plane's blocks take their share of the caches the real blocking was sized for
+    const matrix_dgemm_config *cfg = matrix_kernels_get()->dgemm;
+    bool gauss = (complex_gemm == MATRIX_COMPLEX_GEMM_3M);
+    size_t planes = gauss ? 3 : 2;
+    size_t mc = cfg->mc / planes / cfg->mr * cfg->mr, ncb = cfg->nc / planes / cfg->nr * cfg->nr;
+    mc = mc ? mc : cfg->mr;
+    ncb = ncb ? ncb : cfg->nr;
+    unsigned int num_threads = (flops <= ZGEMM_PARALLEL_FLOPS) ? 1 : matrix_get_num_threads();
+    size_t kc_max = (k < cfg->kc) ? k : cfg->kc;
+    size_t nc_max = (n < ncb) ? n : ncb;
+
+    zgemm_slab s = {
+        .cfg = cfg, .opa = opa, .opb = opb, .gauss = gauss, .lda = lda, .ldb = ldb, .ldc = ldc,
+        .ar = ar, .ai = ai, .m = m, .mc = mc, .num_ic = (m + mc - 1) / mc,
+        .b_plane = ((nc_max + cfg->nr - 1) / cfg->nr) * cfg->nr * kc_max,
+    };
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    s.packed_b = matrix_scratch_alloc(mark, planes * s.b_plane * sizeof(double));
+    if (!s.packed_b) {
+        matrix_scratch_end(mark);
+        zgemm_small(opa, opb, m, n, k, ar, ai, a, lda, b, ldb, br, bi, c, ldc);
+        return;
+    }
+
+    zop_layout la = zop(opa, lda), lb = zop(opb, ldb);
+    for (size_t jc = 0; jc < n; jc += ncb) {
+        s.nc = (n - jc < ncb) ? n - jc : ncb;
+
+        // Split the panel's columns so every thread gets several tiles
+        size_t nr_panels = (s.nc + cfg->nr - 1) / cfg->nr;
+        size_t want = ((size_t)num_threads * ZGEMM_TILES_PER_THREAD + s.num_ic - 1) / s.num_ic;
+        size_t parts = (num_threads == 1) ? 1 : ((want < nr_panels) ? want : nr_panels);
+        s.jr_chunk = ((nr_panels + parts - 1) / parts) * cfg->nr;
+        s.num_jr = (s.nc + s.jr_chunk - 1) / s.jr_chunk;
+
+        for (size_t pc = 0; pc < k; pc += cfg->kc) {
+            s.kc = (k - pc < cfg->kc) ? k - pc : cfg->kc;
+            s.br = (pc == 0) ? br : 1.0;
+            s.bi = (pc == 0) ? bi : 0.0;
+            s.A = a + 2 * pc * la.cs;
+            s.B = b + 2 * (pc * lb.rs + jc * lb.cs);
+            s.C = c + 2 * jc;
+
+            matrix_parallel_for(num_threads, s.num_jr, zgemm_pack_task, &s);
+            matrix_parallel_for(num_threads, s.num_ic * s.num_jr, zgemm_compute_task, &s);
+        }
+    }
+
+    matrix_scratch_end(mark);
+}
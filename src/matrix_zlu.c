@@ -0,0 +1,219 @@
+#include "matrix_internal.h"
+#include <complex.h>
+#include <math.h>
+
+// Complex LU with partial pivoting and the triangular solves it needs, laid out like
+// the real kernels: NB-wide panels factored column by column, row swaps applied to
+// the rest of the matrix, U12 from a triangular solve and the trailing matrix updated
+// with one complex GEMM. Elements are double[2] pairs (see matrix_zgemm.c) and inner
+// loops spell out the complex arithmetic on them.
+
+#define ZLU_NB 64
+
+#define ZTRSM_NB 64
+
+// Pivots smaller than this are treated as zero, as in the real LU
+#define ZLU_PIVOT_TOL 1e-10
+
+// y[0:n] -= a * x[0:n]
+static inline void zaxpy_sub(size_t n, double ar, double ai, const double *x, double *y) {
+    for (size_t j = 0; j < n; j++) {
+        double xr = x[2 * j], xi = x[2 * j + 1];
+        y[2 * j] -= ar * xr - ai * xi;
+        y[2 * j + 1] -= ar * xi + ai * xr;
+    }
+}
+
+// x[0:n] *= a
+static inline void zscal(size_t n, double ar, double ai, double *x) {
+    for (size_t j = 0; j < n; j++) {
+        double xr = x[2 * j], xi = x[2 * j + 1];
+        x[2 * j] = ar * xr - ai * xi;
+        x[2 * j + 1] = ar * xi + ai * xr;
+    }
+}
+
+// 1 / (r + i im)
+static inline void zrecip(double r, double im, double *out_r, double *out_i) {
+    double complex inv = 1.0 / (r + im * I);
+    *out_r = creal(inv);
+    *out_i = cimag(inv);
+}
+
+static void swap_row_segment(double *A, size_t lda, size_t r1, size_t r2, size_t c0, size_t c1) {
+    double *a = A + 2 * r1 * lda;
+    double *b = A + 2 * r2 * lda;
+    for (size_t c = 2 * c0; c < 2 * c1; c++) {
+        double tmp = a[c];
+        a[c] = b[c];
+        b[c] = tmp;
+    }
+}
+
+// Applies the swaps ipiv[k1..k2) to columns [c0, c1) of A.
+static void laswp(double *A, size_t lda, size_t c0, size_t c1, size_t k1, size_t k2, const size_t *ipiv) {
+    if (c0 >= c1) {
+        return;
+    }
+    for (size_t i = k1; i < k2; i++) {
+        if (ipiv[i] != i) {
+            swap_row_segment(A, lda, i, ipiv[i], c0, c1);
+        }
+    }
+}
+
+// Solves the nb x nb diagonal block of T starting at row i0 against B's rows, with row
+// axpys: top down for a lower T, bottom up for an upper one.
+static void ztrsm_block(bool lower, bool unit_diag, size_t i0, size_t nb, size_t n,
+                        const double *T, size_t ldt, double *B, size_t ldb) {
+    for (size_t s = 0; s < nb; s++) {
+        size_t i = lower ? i0 + s : i0 + nb - 1 - s;
+        double *bi = B + 2 * i * ldb;
+        size_t p0 = lower ? i0 : i + 1;
+        size_t p1 = lower ? i : i0 + nb;
+        for (size_t p = p0; p < p1; p++) {
+            const double *t = T + 2 * (i * ldt + p);
+            zaxpy_sub(n, t[0], t[1], B + 2 * p * ldb, bi);
+        }
+        if (!unit_diag) {
+            double dr, di;
+            zrecip(T[2 * (i * ldt + i)], T[2 * (i * ldt + i) + 1], &dr, &di);
+            zscal(n, dr, di, bi);
+        }
+    }
+}
+
+void matrix_ztrsm_left(bool lower, bool unit_diag, size_t m, size_t n,
+                       const double _Complex *T, size_t ldt, double _Complex *B, size_t ldb) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    const double *t = (const double *)T;
+    double *b = (double *)B;
+
+    if (lower) {
+        // Top down: solve a diagonal block, then update every row below it
+        for (size_t i0 = 0; i0 < m; i0 += ZTRSM_NB) {
+            size_t nb = (m - i0 < ZTRSM_NB) ? m - i0 : ZTRSM_NB;
+            ztrsm_block(true, unit_diag, i0, nb, n, t, ldt, b, ldb);
+            if (i0 + nb < m) {
+                matrix_zgemm(MATRIX_OP_NONE, MATRIX_OP_NONE, m - i0 - nb, n, nb, -1.0,
+                             T + (i0 + nb) * ldt + i0, ldt, B + i0 * ldb, ldb, 1.0, B + (i0 + nb) * ldb, ldb);
+            }
+        }
+        return;
+    }
+
+    // Bottom up: solve a diagonal block, then update every row above it
+    size_t i1 = m;
+    while (i1 > 0) {
+        size_t nb = (i1 < ZTRSM_NB) ? i1 : ZTRSM_NB;
+        size_t i0 = i1 - nb;
+        ztrsm_block(false, unit_diag, i0, nb, n, t, ldt, b, ldb);
+        if (i0 > 0) {
+            matrix_zgemm(MATRIX_OP_NONE, MATRIX_OP_NONE, i0, n, nb, -1.0, T + i0, ldt, B + i0 * ldb, ldb, 1.0, B, ldb);
+        }
+        i1 = i0;
+    }
+}
+
+// Unblocked LU of an m x n panel (m >= n); pivots are relative to the panel's first row.
+// Pivots are chosen by |re| + |im|, as LAPACK's izamax does.
+static int zgetf2(size_t m, size_t n, double *A, size_t lda, size_t *ipiv) {
+    for (size_t j = 0; j < n; j++) {
+        size_t pivot = j;
+        double max = -1.0;
+        for (size_t i = j; i < m; i++) {
+            const double *a = A + 2 * (i * lda + j);
+            double v = fabs(a[0]) + fabs(a[1]);
+            if (v > max) {
+                max = v;
+                pivot = i;
+            }
+        }
+
+        if (max < ZLU_PIVOT_TOL) {
+            return -1;
+        }
+
+        ipiv[j] = pivot;
+        if (pivot != j) {
+            swap_row_segment(A, lda, j, pivot, 0, n);
+        }
+
+        const double *aj = A + 2 * j * lda;
+        double rr, ri;
+        zrecip(aj[2 * j], aj[2 * j + 1], &rr, &ri);
+        for (size_t i = j + 1; i < m; i++) {
+            double *ai = A + 2 * i * lda;
+            double xr = ai[2 * j], xi = ai[2 * j + 1];
+            double mr = xr * rr - xi * ri;
+            double mi = xr * ri + xi * rr;
+            ai[2 * j] = mr;
+            ai[2 * j + 1] = mi;
+            zaxpy_sub(n - j - 1, mr, mi, aj + 2 * (j + 1), ai + 2 * (j + 1));
+        }
+    }
+    return 0;
+}
+
+int matrix_zgetrf(size_t n, double _Complex *A, size_t lda, size_t *ipiv) {
+    double *a = (double *)A;
+    for (size_t j = 0; j < n; j += ZLU_NB) {
+        size_t nb = (n - j < ZLU_NB) ? n - j : ZLU_NB;
+
+        if (zgetf2(n - j, nb, a + 2 * (j * lda + j), lda, ipiv + j) != 0) {
+            return -1;
+        }
+        for (size_t i = j; i < j + nb; i++) {
+            ipiv[i] += j;
+        }
+
+        // Bring the columns outside the panel in line with its row swaps
+        laswp(a, lda, 0, j, j, j + nb, ipiv);
+        laswp(a, lda, j + nb, n, j, j + nb, ipiv);
+
+        if (j + nb < n) {
+            size_t rest = n - j - nb;
+            matrix_ztrsm_left(true, true, nb, rest, A + j * lda + j, lda, A + j * lda + j + nb, lda);
+            matrix_zgemm(MATRIX_OP_NONE, MATRIX_OP_NONE, rest, rest, nb, -1.0,
+                         A + (j + nb) * lda + j, lda,
+                         A + j * lda + j + nb, lda,
+                         1.0, A + (j + nb) * lda + j + nb, lda);
+        }
+    }
+    return 0;
+}
+
+int matrix_zgetri(size_t n, double _Complex *A, size_t lda, const size_t *ipiv) {
+    const double *a = (const double *)A;
+    for (size_t i = 0; i < n; i++) {
+        if (a[2 * (i * lda + i)] == 0.0 && a[2 * (i * lda + i) + 1] == 0.0) {
+            return -1;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // inv(A) solves L U X = P: move the factors aside and solve against P in place
+    matrix_scratch_mark mark = matrix_scratch_begin();
+    double _Complex *lu = matrix_scratch_alloc(mark, n * n * sizeof(double _Complex));
+    if (!lu) {
+        matrix_scratch_end(mark);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            lu[i * n + j] = A[i * lda + j];
+            A[i * lda + j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+    laswp((double *)A, lda, 0, n, 0, n, ipiv);
+
+    matrix_ztrsm_left(true, true, n, n, lu, n, A, lda);
+    matrix_ztrsm_left(false, false, n, n, lu, n, A, lda);
+
+    matrix_scratch_end(mark);
+    return 0;
+}
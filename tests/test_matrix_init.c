@@ -2,6 +2,7 @@
 #include <criterion/logging.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <complex.h>
 #include <limits.h>
 #include "../include/matrix.h"  
 
@@ -59,6 +60,26 @@ Test(matrix_operations, set_3x3_matrix_element) {
 
 
 // Test case 1: Set all elements of a matrix to 0
+// Test case for the inline accessors, which must agree with matrix_at and matrix_set
+Test(matrix_operations, inline_get_put_ptr) {
+    matrix *mat = matrix_new(3, 5, sizeof(double));
+
+    for (unsigned int i = 0; i < 3; i++) {
+        for (unsigned int j = 0; j < 5; j++) {
+            matrix_put(mat, i, j, i * 10.0 + j);
+        }
+    }
+
+    cr_assert_eq(matrix_get(mat, 2, 4), 24.0, "matrix_get returned the wrong element");
+    cr_assert_eq(matrix_at(mat, 1, 3), 13.0, "matrix_put stored to the wrong element");
+    cr_assert_eq(matrix_ptr(mat, 1, 0) + 5, matrix_ptr(mat, 2, 0), "Rows must be num_cols elements apart");
+
+    *matrix_ptr(mat, 0, 2) = -1.0;
+    cr_assert_eq(matrix_get(mat, 0, 2), -1.0, "Write through matrix_ptr was not seen");
+
+    matrix_free(mat);
+}
+
 Test(matrix_init, all_set_to_zero) {
     // Create a matrix for testing
     unsigned int num_rows = 3;
@@ -182,6 +203,304 @@ Test(matrix_init, invalid_allocation) {
     cr_assert_null(result, "matrix_rand() should return NULL for allocation that would overflow");
 }
 
+// Allocator that counts what goes through it, for the allocator hook tests
+typedef struct {
+    size_t allocs;
+    size_t aligned_allocs;
+    size_t frees;
+    size_t odd_sizes;  // aligned requests that were not a multiple of the alignment
+} alloc_counts;
+
+static void *counting_alloc(void *ctx, size_t size) {
+    ((alloc_counts *)ctx)->allocs++;
+    return malloc(size);
+}
+
+static void *counting_aligned_alloc(void *ctx, size_t alignment, size_t size) {
+    ((alloc_counts *)ctx)->aligned_allocs++;
+    if (size % alignment != 0) {
+        ((alloc_counts *)ctx)->odd_sizes++;
+    }
+    return aligned_alloc(alignment, size);
+}
+
+static void counting_free(void *ctx, void *ptr) {
+    ((alloc_counts *)ctx)->frees++;
+    free(ptr);
+}
+
+// Test case for routing allocations through a custom allocator
+Test(matrix_init, custom_allocator) {
+    alloc_counts counts = {0, 0, 0, 0};
+    matrix_allocator counting = { counting_alloc, counting_aligned_alloc, counting_free, &counts };
+    matrix_allocator incomplete = { counting_alloc, NULL, counting_free, &counts };
+
+    cr_assert_not(matrix_set_allocator(&incomplete), "An allocator without aligned_alloc must be rejected");
+    cr_assert(matrix_set_allocator(&counting), "Installing a complete allocator failed");
+    cr_assert_eq(matrix_get_allocator().ctx, &counts, "matrix_get_allocator must return the installed allocator");
+
+    matrix *a = matrix_rand(4, 4, -1.0, 1.0, sizeof(double));
+    matrix_diag_set(a, &(double){10.0}, sizeof(double));
+    matrix *b = matrix_mult(a, a);
+    matrix_lup *lu = matrix_lup_factor(b, false);
+    cr_assert_not_null(lu, "LU factorization failed under a custom allocator");
+    cr_assert_eq(counts.aligned_allocs, 3, "Every matrix buffer must come from the custom allocator");
+    cr_assert_geq(counts.allocs, 5, "Matrix headers and LU bookkeeping must come from the custom allocator");
+    cr_assert_eq(counts.odd_sizes, 0, "Aligned allocations must be a multiple of the alignment");
+
+    matrix_lup_free(lu);
+    matrix_free(a);
+    matrix_free(b);
+    cr_assert_eq(counts.frees, counts.allocs + counts.aligned_allocs, "Every allocation must be freed through the allocator");
+
+    cr_assert(matrix_set_allocator(NULL), "Restoring the default allocator failed");
+    matrix *c = matrix_new(2, 2, sizeof(double));
+    matrix_free(c);
+    cr_assert_eq(counts.aligned_allocs, 3, "The default allocator must be back in place");
+}
+
+// Test case for the configurable allocation cap
+Test(matrix_init, max_allocation_policy) {
+    cr_assert_eq(matrix_get_max_allocation(), (size_t)1024 * 1024 * 1024, "Default cap should be 1 GB");
+
+    matrix_set_max_allocation(100 * 100 * sizeof(double));
+    matrix *fits = matrix_new(100, 100, sizeof(double));
+    matrix *too_big = matrix_new(100, 101, sizeof(double));
+    cr_assert_not_null(fits, "Allocation at the cap should succeed");
+    cr_assert_null(too_big, "Allocation above the cap should fail");
+
+    matrix_set_max_allocation(0);
+    cr_assert_eq(matrix_get_max_allocation(), (size_t)1024 * 1024 * 1024, "0 should restore the default cap");
+    too_big = matrix_new(100, 101, sizeof(double));
+    cr_assert_not_null(too_big, "Allocation below the default cap should succeed");
+
+    matrix_free(fits);
+    matrix_free(too_big);
+}
+
+// Test case for large matrices mapped from the kernel instead of the heap
+Test(matrix_init, mapped_allocation) {
+    unsigned int n = 200;
+    matrix *small = matrix_new(n, n, sizeof(double));
+    cr_assert_not(small->mapped, "A 320 KB matrix should come from the heap by default");
+
+    matrix_set_mmap_threshold(64 * 1024);
+    matrix_huge_pages modes[] = { MATRIX_HUGE_PAGES_NONE, MATRIX_HUGE_PAGES_TRANSPARENT, MATRIX_HUGE_PAGES_EXPLICIT };
+    for (unsigned int m = 0; m < 3; m++) {
+        matrix_set_huge_pages(modes[m]);
+        matrix *big = matrix_new_padded(n, n, sizeof(double));
+        cr_assert_not_null(big, "Mapped allocation failed");
+        cr_assert(big->mapped, "Matrix above the threshold should be mapped");
+        cr_assert_eq((uintptr_t)big->data % 64, 0, "Mapped data must be 64-byte aligned");
+        for (unsigned int i = 0; i < n; i++) {
+            for (unsigned int j = 0; j < n; j++) {
+                cr_assert_eq(matrix_get(big, i, j), 0.0, "Mapped matrix must start zeroed");
+            }
+        }
+
+        // Mapped matrices behave like any other, transposition included
+        matrix_all_set(big, &(double){2.0}, sizeof(double));
+        matrix *product = matrix_mult(big, big);
+        cr_assert_eq(matrix_at(product, 3, 5), 4.0 * n, "Product of mapped matrices is incorrect");
+        matrix_transpose(big);
+        cr_assert(big->mapped, "Transposing should keep a large matrix mapped");
+        matrix_free(product);
+        matrix_free(big);
+    }
+    matrix_set_huge_pages(MATRIX_HUGE_PAGES_TRANSPARENT);
+    matrix_set_mmap_threshold(0);
+
+    matrix_free(small);
+}
+
+// Test case for 64-bit dimensions: sizes and indices past 32 bits must not wrap around
+Test(matrix_init, dimensions_past_32_bits) {
+    size_t big = (size_t)UINT_MAX + 2;
+    cr_assert_null(matrix_new(big, 1, sizeof(double)), "A 32 GB request must fail the cap, not wrap to 1 row");
+
+    matrix *mat = matrix_new(3, 3, sizeof(double));
+    matrix_set(mat, big - 1, 1, 5.0);
+    matrix_set(mat, 1, big, 5.0);
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t j = 0; j < 3; j++) {
+            cr_assert_eq(matrix_get(mat, i, j), 0.0, "Out-of-range matrix_set wrote element (%zu, %zu)", i, j);
+        }
+    }
+
+    Range wide = {0, (int64_t)big};
+    Range first = {0, 1};
+    cr_assert_null(matrix_view(mat, first, wide).data, "A range past 32 bits must be rejected");
+    cr_assert_null(matrix_row_view(mat, big - 2).data, "A row index past 32 bits must be rejected");
+
+    matrix_free(mat);
+}
+
+// Test case for float32 matrices: the element size picks the type, values convert on the way in and out
+Test(matrix_init, float32_dtype) {
+    matrix *f = matrix_new_padded(3, 5, sizeof(float));
+    cr_assert_not_null(f, "Float matrix allocation returned NULL");
+    cr_assert_eq(f->dtype, MATRIX_F32, "sizeof(float) must give a MATRIX_F32 matrix");
+    cr_assert_eq(matrix_element_size(f), sizeof(float), "Float elements are 4 bytes");
+    cr_assert_eq(f->stride, 16, "A padded float row is one 64-byte line");
+    cr_assert_null(matrix_new(3, 3, 3), "Element sizes other than double and float are refused");
+
+    double half = 0.5;
+    matrix_all_set(f, &half, sizeof(half));
+    float two = 2.0f;
+    matrix_set(f, 2, 4, 1.25);
+    cr_assert_eq(*matrix_ptr_f32(f, 0, 0), 0.5f, "matrix_all_set must convert the double value");
+    cr_assert_eq(matrix_at(f, 2, 4), 1.25, "matrix_set must store into the float element");
+
+    matrix *d = matrix_convert(f, MATRIX_F64);
+    cr_assert_not_null(d, "matrix_convert returned NULL");
+    cr_assert_eq(d->dtype, MATRIX_F64, "Converted matrix has the wrong type");
+    cr_assert(matrix_eq(d, f, 0.0), "Widening to double must be exact");
+
+    matrix *t = matrix_copy(f);
+    matrix_transpose(t);
+    cr_assert_eq(t->dtype, MATRIX_F32, "Transposing must keep the element type");
+    cr_assert_eq(matrix_get(t, 4, 2), 1.25, "Transposed float element is wrong");
+
+    matrix *sq = matrix_sqr(3, sizeof(float));
+    matrix_diag_set(sq, &two, sizeof(two));
+    cr_assert_eq(matrix_trace(sq), 6.0, "matrix_diag_set must accept a float value");
+    cr_assert_null(matrix_add(d, f), "Mixing element types must be refused");
+    cr_assert_null(matrix_subtract(d, f), "Mixing element types must be refused");
+    cr_assert_null(matrix_stackv(d, f), "Stacking mixed element types must be refused");
+    cr_assert_null(matrix_stackh(d, f), "Stacking mixed element types must be refused");
+
+    matrix_free(f);
+    matrix_free(d);
+    matrix_free(t);
+    matrix_free(sq);
+}
+
+// Test case for aligned storage and padded rows
+Test(matrix_init, aligned_and_padded_allocation) {
+    matrix *dense = matrix_new(5, 3, sizeof(double));
+    cr_assert_not_null(dense, "Matrix allocation returned NULL");
+    cr_assert_eq(dense->stride, 3, "matrix_new must keep rows contiguous");
+    cr_assert_eq((uintptr_t)dense->data % 64, 0, "Data must be 64-byte aligned");
+
+    matrix *padded = matrix_new_padded(5, 3, sizeof(double));
+    cr_assert_not_null(padded, "Padded matrix allocation returned NULL");
+    cr_assert_eq(padded->stride, 8, "Rows must be padded to a whole cache line");
+    cr_assert_eq((uintptr_t)padded->data % 64, 0, "Data must be 64-byte aligned");
+    for (unsigned int i = 0; i < 5; i++) {
+        cr_assert_eq((uintptr_t)matrix_ptr(padded, i, 0) % 64, 0, "Row %u is not 64-byte aligned", i);
+        for (unsigned int j = 0; j < 3; j++) {
+            cr_assert_eq(matrix_get(padded, i, j), 0.0, "Padded matrix must start zeroed");
+        }
+    }
+
+    // Power-of-two widths get an extra cache line so rows don't alias
+    matrix *wide = matrix_new_padded(4, 256, sizeof(double));
+    cr_assert_eq(wide->stride, 264, "Power-of-two width was not padded");
+
+    matrix_free(dense);
+    matrix_free(padded);
+    matrix_free(wide);
+}
+
+// Test case for workspace arenas: aligned bump allocation, O(1) reset, and no growth
+// once a caller-provided arena has warmed up to a workload
+Test(matrix_init, workspace_arena) {
+    matrix_arena *arena = matrix_arena_new(1024);
+    cr_assert_not_null(arena, "Arena allocation returned NULL");
+
+    double *first = matrix_arena_alloc(arena, 100);
+    double *second = matrix_arena_alloc(arena, 100);
+    cr_assert_eq((uintptr_t)first % 64, 0, "Arena memory must be 64-byte aligned");
+    cr_assert_eq((uintptr_t)second % 64, 0, "Arena memory must be 64-byte aligned");
+    cr_assert_geq((char *)second - (char *)first, 100, "Arena allocations overlap");
+    cr_assert_not_null(matrix_arena_alloc(arena, 4096), "Arena did not grow past its first block");
+    matrix_arena_reset(arena);
+    cr_assert_eq(matrix_arena_alloc(arena, 10), first, "Reset must hand out the same memory again");
+    matrix_arena_reset(arena);
+
+    unsigned int n = 300;
+    matrix *a = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix_diag_set(a, &(double){(double)n}, sizeof(double));
+    matrix *inverse = matrix_new(n, n, sizeof(double));
+
+    // Serial, so every temporary comes from this thread's arena in the same order each time
+    matrix_set_num_threads(1);
+    cr_assert_null(matrix_arena_use(arena), "No arena should be installed by default");
+    for (int iter = 0; iter < 2; iter++) {
+        matrix_inv_into(inverse, a);
+        matrix_is_posdef(a);
+    }
+    size_t warm = matrix_arena_capacity(arena);
+    for (int iter = 0; iter < 3; iter++) {
+        cr_assert_not_null(matrix_inv_into(inverse, a), "Inversion from an arena failed");
+        cr_assert(matrix_is_posdef(a), "Diagonally dominant matrix should have positive leading minors");
+    }
+    cr_assert_eq(matrix_arena_capacity(arena), warm, "Arena kept growing after warm-up");
+
+    // A problem-sized temporary (an 800 x 800 copy, 5 MB) is returned, not kept
+    matrix *big = matrix_rand(800, 800, -1.0, 1.0, sizeof(double));
+    matrix_diag_set(big, &(double){800.0}, sizeof(double));
+    cr_assert(matrix_is_posdef(big), "Diagonally dominant matrix should have positive leading minors");
+    cr_assert_eq(matrix_arena_capacity(arena), warm, "Arena kept a large temporary");
+    matrix_free(big);
+    cr_assert_eq(matrix_arena_use(NULL), arena, "matrix_arena_use must return the previous arena");
+    matrix_set_num_threads(0);
+
+    matrix *product = matrix_mult(a, inverse);
+    matrix *eye = matrix_eye(n, sizeof(double), &(double){1.0});
+    cr_assert(matrix_eq(product, eye, 1e-10), "Inverse computed from an arena is incorrect");
+
+    matrix_arena_free(arena);
+    matrix_free(a);
+    matrix_free(inverse);
+    matrix_free(product);
+    matrix_free(eye);
+}
+
+// Test case for every operation honouring the stride of padded matrices
+Test(matrix_init, padded_matrix_operations) {
+    unsigned int n = 130;
+    matrix *a = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *b = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *pa = matrix_new_padded(n, n, sizeof(double));
+    matrix *pb = matrix_new_padded(n, n, sizeof(double));
+    cr_assert_neq(pa->stride, pa->num_cols, "Test needs a padded stride");
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            matrix_put(pa, i, j, matrix_get(a, i, j) + (i == j ? n : 0.0));
+            matrix_put(a, i, j, matrix_get(pa, i, j));
+            matrix_put(pb, i, j, matrix_get(b, i, j));
+        }
+    }
+
+    matrix *sum = matrix_add(a, b), *psum = matrix_add(pa, pb);
+    matrix *prod = matrix_mult(a, b), *pprod = matrix_mult(pa, pb);
+    matrix *inv = matrix_inv(a), *pinv = matrix_inv(pa);
+    cr_assert(matrix_eq(sum, psum, 0.0), "Addition differs for padded matrices");
+    cr_assert(matrix_eq(prod, pprod, 1e-12), "Multiplication differs for padded matrices");
+    cr_assert(matrix_eq(inv, pinv, 1e-12), "Inversion differs for padded matrices");
+
+    matrix *pcopy = matrix_copy(pa);
+    cr_assert_eq(pcopy->stride, pa->stride, "Copies must keep the stride");
+    matrix_transpose(pcopy);
+    matrix_transpose(pcopy);
+    cr_assert(matrix_eq(pcopy, a, 0.0), "Double transpose differs for padded matrices");
+
+    matrix *pstack = matrix_stackh(pa, pb), *stack = matrix_stackh(a, b);
+    cr_assert(matrix_eq(pstack, stack, 0.0), "Horizontal stack differs for padded matrices");
+
+    matrix_lup *lu = matrix_lup_factor(pa, false);
+    matrix *x = matrix_ls_solve(lu, pb);
+    matrix *ax = matrix_mult(pa, x);
+    cr_assert(matrix_eq(ax, pb, 1e-9), "Solve differs for padded matrices");
+
+    matrix *arrays[] = { a, b, pa, pb, sum, psum, prod, pprod, inv, pinv, pcopy, pstack, stack, x, ax };
+    for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++) {
+        matrix_free(arrays[i]);
+    }
+    matrix_lup_free(lu);
+}
+
 Test(matrix_init, square_matrix) {
     unsigned int size = 4;
     matrix *mat = matrix_sqr(size, sizeof(double));
@@ -273,6 +592,39 @@ Test(matrix_init, transpose_rectangular_matrix) {
     matrix_free(mat);
 }
 
+// Test case for in-place transposes, which must keep the buffer and match matrix_transpose_into
+Test(matrix_init, transpose_in_place_keeps_buffer) {
+    size_t shapes[][2] = { {300, 300}, {257, 100}, {100, 257}, {1, 77}, {33, 31} };
+    size_t sizes[] = { sizeof(double), sizeof(float), sizeof(double _Complex) };
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        size_t rows = shapes[s][0], cols = shapes[s][1];
+        for (size_t e = 0; e < 3; e++) {
+            for (int padded = 0; padded < 2; padded++) {
+                matrix *a = padded ? matrix_new_padded(rows, cols, sizes[e]) : matrix_new(rows, cols, sizes[e]);
+                matrix *r = matrix_rand(rows, cols, -1.0, 1.0, sizes[e]);
+                matrix_copy_into(a, r);
+                matrix *expected = matrix_new(cols, rows, sizes[e]);
+                cr_assert_not_null(matrix_conj_transpose_into(expected, a), "Out-of-place transpose failed");
+
+                void *data = a->data;
+                matrix_conj_transpose(a);
+                cr_assert_eq(a->data, data, "An in-place transpose must not reallocate");
+                cr_assert_eq(a->num_rows, cols, "Rows and columns must be swapped");
+                cr_assert_eq(a->is_square, rows == cols, "is_square must describe the new shape");
+                cr_assert(matrix_eq(a, expected, 0.0), "In-place transpose of %zu x %zu differs", rows, cols);
+                if (sizes[e] == sizeof(double _Complex)) {
+                    cr_assert_eq(matrix_get_c(a, cols - 1, 0), conj(matrix_get_c(r, 0, cols - 1)),
+                                 "Complex elements must be conjugated");
+                }
+
+                matrix_free(a);
+                matrix_free(r);
+                matrix_free(expected);
+            }
+        }
+    }
+}
+
 Test(matrix_init, stackv_square_matrices) {
     matrix *mat1 = matrix_new(2, 2, sizeof(double));
     matrix *mat2 = matrix_new(2, 2, sizeof(double));
@@ -351,6 +703,44 @@ Test(matrix_init, stackh_rectangular_matrices) {
 }
 
 
+// Test case for copy, transpose and stacking into preallocated results
+Test(matrix_init, copy_transpose_stack_into) {
+    matrix *mat1 = matrix_rand(3, 5, -1.0, 1.0, sizeof(double));
+    matrix *mat2 = matrix_rand(3, 5, -1.0, 1.0, sizeof(double));
+
+    matrix *copy = matrix_new_padded(3, 5, sizeof(double));
+    cr_assert_eq(matrix_copy_into(copy, mat1), copy, "matrix_copy_into must return dst");
+    cr_assert(matrix_eq(copy, mat1, 0.0), "matrix_copy_into did not copy the elements");
+
+    matrix *transposed = matrix_new(5, 3, sizeof(double));
+    cr_assert_eq(matrix_transpose_into(transposed, mat1), transposed, "matrix_transpose_into must return dst");
+    for (unsigned int i = 0; i < 3; i++) {
+        for (unsigned int j = 0; j < 5; j++) {
+            cr_assert_eq(matrix_at(transposed, j, i), matrix_at(mat1, i, j), "Incorrect value in transposed matrix");
+        }
+    }
+    cr_assert_null(matrix_transpose_into(copy, mat1), "Transposing into a wrongly shaped matrix should fail");
+
+    matrix *stackedv = matrix_stackv(mat1, mat2);
+    matrix *stackedh = matrix_stackh(mat1, mat2);
+    matrix *intov = matrix_new(6, 5, sizeof(double));
+    matrix *intoh = matrix_new(3, 10, sizeof(double));
+    cr_assert_eq(matrix_stackv_into(intov, mat1, mat2), intov, "matrix_stackv_into must return dst");
+    cr_assert_eq(matrix_stackh_into(intoh, mat1, mat2), intoh, "matrix_stackh_into must return dst");
+    cr_assert(matrix_eq(intov, stackedv, 0.0), "matrix_stackv_into differs from matrix_stackv");
+    cr_assert(matrix_eq(intoh, stackedh, 0.0), "matrix_stackh_into differs from matrix_stackh");
+    cr_assert_null(matrix_stackh_into(intov, mat1, mat2), "Stacking into a wrongly shaped matrix should fail");
+
+    matrix_free(mat1);
+    matrix_free(mat2);
+    matrix_free(copy);
+    matrix_free(transposed);
+    matrix_free(stackedv);
+    matrix_free(stackedh);
+    matrix_free(intov);
+    matrix_free(intoh);
+}
+
 // Test case for removing a row
 Test(matrix_init, row_remove_first) {
     matrix *mat = matrix_new(3, 3, sizeof(double));
@@ -2,6 +2,9 @@
 #include <criterion/logging.h>
 #include "../include/matrix.h"
 #include <stdio.h>
+#include <math.h>
+#include <complex.h>
+#include <string.h>
 
 // Test case for multiplying a row by a scalar
 Test(matrix_math, row_mult_r) {
@@ -231,7 +234,139 @@ Test(matrix_math, matrix_mult_rectangular_matrices) {
     matrix_free(result);
 }
 
+// Test case for a product large enough to go through the packed, blocked GEMM path
+// (sizes are not multiples of the register tile, so edge tiles are exercised too)
+Test(matrix_math, matrix_mult_blocked_matches_naive) {
+    unsigned int m = 131, k = 277, n = 97;
+    matrix *mat1 = matrix_rand(m, k, -1.0, 1.0, sizeof(double));
+    matrix *mat2 = matrix_rand(k, n, -1.0, 1.0, sizeof(double));
+
+    matrix *result = matrix_mult(mat1, mat2);
+    cr_assert_not_null(result, "Matrix multiplication returned NULL");
+
+    double *data1 = (double *)mat1->data;
+    double *data2 = (double *)mat2->data;
+    double *result_data = (double *)result->data;
+
+    for (unsigned int i = 0; i < m; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double sum = 0.0;
+            for (unsigned int p = 0; p < k; p++) {
+                sum += data1[i * k + p] * data2[p * n + j];
+            }
+            cr_assert_float_eq(result_data[i * n + j], sum, 1e-9, "Element at [%u][%u] is not correct", i, j);
+        }
+    }
+
+    matrix_free(mat1);
+    matrix_free(mat2);
+    matrix_free(result);
+}
+
 // Test case for pivotidx function
+// Test case for add/subtract into a preallocated result, including into an operand
+Test(matrix_math, add_subtract_into) {
+    matrix *mat1 = matrix_rand(5, 7, -1.0, 1.0, sizeof(double));
+    matrix *mat2 = matrix_rand(5, 7, -1.0, 1.0, sizeof(double));
+    matrix *dst = matrix_new_padded(5, 7, sizeof(double));
+
+    cr_assert_eq(matrix_add_into(dst, mat1, mat2), dst, "matrix_add_into must return dst");
+    matrix *sum = matrix_add(mat1, mat2);
+    cr_assert(matrix_eq(dst, sum, 0.0), "matrix_add_into differs from matrix_add");
+
+    cr_assert_eq(matrix_subtract_into(dst, dst, mat2), dst, "matrix_subtract_into must return dst");
+    cr_assert(matrix_eq(dst, mat1, 1e-15), "(mat1 + mat2) - mat2 should give mat1 back");
+
+    matrix *wrong = matrix_new(7, 5, sizeof(double));
+    cr_assert_null(matrix_add_into(wrong, mat1, mat2), "Adding into a wrongly shaped matrix should fail");
+
+    matrix_free(mat1);
+    matrix_free(mat2);
+    matrix_free(dst);
+    matrix_free(sum);
+    matrix_free(wrong);
+}
+
+// Test case for the flat element-wise kernels above the threading and streaming
+// thresholds, on packed, padded and view operands of every element type
+Test(matrix_math, elementwise_large_threaded) {
+    size_t n = 1030;
+    size_t sizes[] = { sizeof(double), sizeof(float), sizeof(double complex) };
+    matrix_set_num_threads(4);
+
+    for (size_t t = 0; t < 3; t++) {
+        double tol = (sizes[t] == sizeof(float)) ? 1e-6 : 1e-14;
+        matrix *a = matrix_rand(n, n, -1.0, 1.0, sizes[t]);
+        matrix *b = matrix_rand(n, n, -1.0, 1.0, sizes[t]);
+        matrix *padded = matrix_new_padded(n, n, sizes[t]);
+
+        matrix *sum = matrix_add(a, b);
+        cr_assert_not_null(sum, "matrix_add returned NULL");
+        cr_assert_not_null(matrix_subtract_into(padded, sum, b), "Subtracting into a padded matrix failed");
+        cr_assert(matrix_eq(padded, a, tol), "(a + b) - b should give a back");
+
+        matrix_mult_r(sum, 0.5);
+        size_t spots[][2] = { { 0, 0 }, { 517, 3 }, { n - 1, n - 1 } };
+        for (size_t s = 0; s < 3; s++) {
+            size_t i = spots[s][0], j = spots[s][1];
+            double complex expected = 0.5 * (matrix_get_c(a, i, j) + matrix_get_c(b, i, j));
+            cr_assert(cabs(matrix_get_c(sum, i, j) - expected) < tol, "mult_r is wrong at (%zu, %zu)", i, j);
+        }
+
+        double complex v = (sizes[t] == sizeof(double complex)) ? 1.5 - 2.0 * I : 1.5;
+        matrix_all_set(a, &v, sizeof(v));
+        cr_assert_eq(matrix_get_c(a, n - 1, n - 1), v, "Fill missed the last element");
+        matrix inner = matrix_view(padded, (Range){ 1, (int64_t)n - 1 }, (Range){ 1, (int64_t)n - 1 });
+        matrix_all_set(&inner, &v, sizeof(v));
+        cr_assert_eq(matrix_get_c(padded, 1, 1), v, "Fill through a view missed its first element");
+        cr_assert_eq(matrix_get_c(padded, n - 2, n - 2), v, "Fill through a view missed its last element");
+        cr_assert_neq(matrix_get_c(padded, n - 1, n - 1), v, "Fill through a view wrote outside it");
+
+        matrix_free(a);
+        matrix_free(b);
+        matrix_free(padded);
+        matrix_free(sum);
+    }
+    matrix_set_num_threads(0);
+}
+
+// Test case for C = alpha * A * B + beta * C, and for the aliasing checks
+Test(matrix_math, gemm_into_accumulates) {
+    unsigned int m = 67, k = 45, n = 38;
+    matrix *A = matrix_rand(m, k, -1.0, 1.0, sizeof(double));
+    matrix *B = matrix_rand(k, n, -1.0, 1.0, sizeof(double));
+    matrix *C = matrix_rand(m, n, -1.0, 1.0, sizeof(double));
+    matrix *C0 = matrix_copy(C);
+    matrix *AB = matrix_mult(A, B);
+
+    cr_assert_eq(matrix_gemm_into(C, 0.5, A, B, -2.0), C, "matrix_gemm_into must return dst");
+    for (unsigned int i = 0; i < m; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double expected = 0.5 * matrix_at(AB, i, j) - 2.0 * matrix_at(C0, i, j);
+            cr_assert_float_eq(matrix_at(C, i, j), expected, 1e-12, "Element at [%u][%u] is not correct", i, j);
+        }
+    }
+
+    // beta == 0 must ignore whatever dst held, NaNs included
+    matrix_all_set(C, &(double){NAN}, sizeof(double));
+    cr_assert_eq(matrix_mult_into(C, A, B), C, "matrix_mult_into must return dst");
+    cr_assert(matrix_eq(C, AB, 0.0), "matrix_mult_into differs from matrix_mult");
+
+    // Products into one of their own inputs are refused
+    matrix *S = matrix_rand(k, k, -1.0, 1.0, sizeof(double));
+    cr_assert_null(matrix_mult_into(S, S, S), "Multiplying into an input should fail");
+    matrix *wrong = matrix_new(n, m, sizeof(double));
+    cr_assert_null(matrix_mult_into(wrong, A, B), "Multiplying into a wrongly shaped matrix should fail");
+
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(C);
+    matrix_free(C0);
+    matrix_free(AB);
+    matrix_free(S);
+    matrix_free(wrong);
+}
+
 Test(matrix_math, pivotidx_test) {
     matrix *mat = matrix_new(3, 3, sizeof(double));
     double values[9] = {0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0};
@@ -337,6 +472,11 @@ Test(matrix_math, lup_factorization_2x2_test) {
     // Check if the LUP decomposition was successfully created
     cr_assert_not_null(lup, "LUP decomposition creation failed");
 
+    // P is kept as pivots until it is asked for
+    cr_assert_null(lup->P, "Dense P should not be built by the factorization");
+    cr_assert_not_null(lup->pivots, "Pivots in LUP decomposition are NULL");
+    cr_assert_not_null(matrix_lup_P(lup), "P matrix in LUP decomposition is NULL");
+
     // Check if the L, U, and P matrices are not NULL
     cr_assert_not_null(lup->L, "L matrix in LUP decomposition is NULL");
     cr_assert_not_null(lup->U, "U matrix in LUP decomposition is NULL");
@@ -372,6 +512,123 @@ Test(matrix_math, lup_factorization_2x2_test) {
 
 }
 
+// Test case for the blocked LU path: P * A must equal L * U for a matrix wider than one panel
+Test(matrix_math, lup_factorization_blocked_test) {
+    unsigned int n = 300;
+    matrix *mat = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+
+    matrix_lup *lup = matrix_lup_solve(mat);
+    cr_assert_not_null(lup, "LUP decomposition creation failed");
+
+    // L is unit lower triangular and U is upper triangular
+    for (unsigned int i = 0; i < n; i++) {
+        cr_assert_eq(matrix_at(lup->L, i, i), 1.0, "L diagonal at %u is not 1", i);
+        for (unsigned int j = i + 1; j < n; j++) {
+            cr_assert_eq(matrix_at(lup->L, i, j), 0.0, "L has a non-zero above the diagonal at [%u][%u]", i, j);
+            cr_assert_eq(matrix_at(lup->U, j, i), 0.0, "U has a non-zero below the diagonal at [%u][%u]", j, i);
+        }
+    }
+
+    matrix *LU = matrix_mult(lup->L, lup->U);
+    matrix *PA = matrix_mult(matrix_lup_P(lup), mat);
+    cr_assert(matrix_eq(LU, PA, 1e-9), "P * A does not match L * U");
+
+    matrix_free(LU);
+    matrix_free(PA);
+    matrix_lup_free(lup);
+    matrix_free(mat);
+}
+
+// Test case for applying the pivots in place against multiplying by the dense P
+Test(matrix_math, lup_permute_matches_dense_P) {
+    unsigned int n = 50;
+    matrix *mat = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *b = matrix_rand(n, 3, -1.0, 1.0, sizeof(double));
+
+    matrix_lup *lup = matrix_lup_solve(mat);
+    cr_assert_not_null(lup, "LUP decomposition creation failed");
+
+    matrix *Pb = matrix_mult(matrix_lup_P(lup), b);
+    matrix_lup_permute(lup, b);
+    cr_assert(matrix_eq(Pb, b, 0.0), "In-place permutation does not match P * b");
+
+    matrix_free(Pb);
+    matrix_free(b);
+    matrix_lup_free(lup);
+    matrix_free(mat);
+}
+
+// Test case for matrix_lup_new() turning a caller-supplied P into pivots
+Test(matrix_math, lup_new_pivots_from_P) {
+    double val = 1.0;
+    matrix *L = matrix_eye(3, sizeof(double), &val);
+    matrix *U = matrix_eye(3, sizeof(double), &val);
+    matrix *P = matrix_new(3, 3, sizeof(double));
+    double P_values[9] = {0.0, 0.0, 1.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+    memcpy(P->data, P_values, 9 * sizeof(double));
+
+    matrix_lup *lup = matrix_lup_new(L, U, P, 2);
+    cr_assert_not_null(lup, "LUP decomposition creation failed");
+
+    matrix *b = matrix_new(3, 1, sizeof(double));
+    double b_values[3] = {10.0, 20.0, 30.0};
+    memcpy(b->data, b_values, 3 * sizeof(double));
+
+    matrix *Pb = matrix_mult(P, b);
+    matrix_lup_permute(lup, b);
+    cr_assert(matrix_eq(Pb, b, 0.0), "Pivots derived from P do not reproduce P * b");
+
+    matrix_free(Pb);
+    matrix_free(b);
+    matrix_lup_free(lup);
+}
+
+// Test case for the packed, in-place factorization: no copy, same factors as matrix_lup_solve
+Test(matrix_math, lup_factor_in_place_packed) {
+    unsigned int n = 40;
+    matrix *mat = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *work = matrix_copy(mat);
+
+    matrix_lup *dense = matrix_lup_solve(mat);
+    matrix_lup *packed = matrix_lup_factor(work, true);
+    cr_assert_not_null(dense, "LUP decomposition creation failed");
+    cr_assert_not_null(packed, "Packed LUP decomposition creation failed");
+
+    // The caller's matrix holds the factors and nothing dense is built up front
+    cr_assert_eq(packed->LU, work, "In-place factorization should reuse the input matrix");
+    cr_assert_null(packed->L, "Dense L should not be built by the packed factorization");
+    cr_assert_null(packed->U, "Dense U should not be built by the packed factorization");
+
+    cr_assert(matrix_eq(matrix_lup_L(packed), dense->L, 0.0), "Packed L does not match dense L");
+    cr_assert(matrix_eq(matrix_lup_U(packed), dense->U, 0.0), "Packed U does not match dense U");
+    cr_assert_float_eq(matrix_det(packed), matrix_det(dense), 1e-9, "Determinants do not match");
+
+    matrix *b = matrix_rand(n, 1, -1.0, 1.0, sizeof(double));
+    matrix *x = matrix_ls_solve(packed, b);
+    matrix *Ax = matrix_mult(mat, x);
+    cr_assert(matrix_eq(Ax, b, 1e-9), "Solution from the packed factors is incorrect");
+
+    matrix_free(Ax);
+    matrix_free(x);
+    matrix_free(b);
+    matrix_lup_free(packed);
+    matrix_lup_free(dense);
+    matrix_free(work);
+    matrix_free(mat);
+}
+
+// Test case for a singular matrix, which has no LUP decomposition
+Test(matrix_math, lup_factorization_singular_test) {
+    matrix *mat = matrix_new(3, 3, sizeof(double));
+    double values[9] = {1.0, 2.0, 3.0, 2.0, 4.0, 6.0, 1.0, 0.0, 1.0};
+    memcpy(mat->data, values, 9 * sizeof(double));
+
+    matrix_lup *lup = matrix_lup_solve(mat);
+    cr_assert_null(lup, "LUP decomposition of a singular matrix should fail");
+
+    matrix_free(mat);
+}
+
 Test(matrix_math, ls_solvefwd_2x2) {
     // Create a 2x2 lower triangular matrix L
     matrix *L = matrix_new(2, 2, sizeof(double));
@@ -634,3 +891,593 @@ Test(matrix_operations, determinant_3x3_matrix) {
     matrix_lup_free(lu);
     matrix_free(mat);
 }
+
+// Test case for the thread count API and that a threaded product matches a single-threaded one
+Test(matrix_math, matrix_mult_threaded_matches_serial) {
+    matrix *mat1 = matrix_rand(300, 257, -1.0, 1.0, sizeof(double));
+    matrix *mat2 = matrix_rand(257, 311, -1.0, 1.0, sizeof(double));
+
+    matrix_set_num_threads(1);
+    cr_assert_eq(matrix_get_num_threads(), 1, "Thread count was not applied");
+    matrix *serial = matrix_mult(mat1, mat2);
+
+    matrix_set_num_threads(4);
+    cr_assert_eq(matrix_get_num_threads(), 4, "Thread count was not applied");
+    matrix *threaded = matrix_mult(mat1, mat2);
+
+    cr_assert_not_null(serial, "Serial multiplication returned NULL");
+    cr_assert_not_null(threaded, "Threaded multiplication returned NULL");
+    cr_assert(matrix_eq(serial, threaded, 0.0), "Threaded product differs from the serial one");
+
+    matrix_set_num_threads(0);
+    cr_assert_geq(matrix_get_num_threads(), 1, "Default thread count must be at least 1");
+
+    matrix_free(mat1);
+    matrix_free(mat2);
+    matrix_free(serial);
+    matrix_free(threaded);
+}
+
+// Test case for solving many right-hand sides at once against one factorization
+Test(matrix_math, ls_solve_multiple_rhs) {
+    unsigned int n = 150, k = 300;
+    matrix *A = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    for (unsigned int i = 0; i < n; i++) {
+        ((double *)A->data)[i * n + i] += n; // keep the system well conditioned
+    }
+    matrix *B = matrix_rand(n, k, -1.0, 1.0, sizeof(double));
+
+    matrix_lup *lu = matrix_lup_factor(A, false);
+    cr_assert_not_null(lu, "LUP factorization returned NULL");
+
+    matrix *X = matrix_ls_solve(lu, B);
+    cr_assert_not_null(X, "Solution is NULL");
+    cr_assert_eq(X->num_rows, n, "Solution has incorrect number of rows");
+    cr_assert_eq(X->num_cols, k, "Solution has incorrect number of columns");
+
+    matrix *AX = matrix_mult(A, X);
+    cr_assert(matrix_eq(AX, B, 1e-9), "A * X does not reproduce B");
+
+    // Each column must match the single right-hand-side solve
+    Range all_rows = {-1, -1};
+    for (unsigned int col = 0; col < k; col += 37) {
+        Range col_range = {col, col + 1};
+        matrix *b = matrix_slice(B, all_rows, col_range);
+        matrix *x = matrix_ls_solve(lu, b);
+        for (unsigned int i = 0; i < n; i++) {
+            cr_assert_float_eq(matrix_at(x, i, 0), matrix_at(X, i, col), 1e-12,
+                               "Column %u differs from the single solve at row %u", col, i);
+        }
+        matrix_free(b);
+        matrix_free(x);
+    }
+
+    matrix_lup_free(lu);
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(X);
+    matrix_free(AX);
+}
+
+// Test case for forward and back substitution with several right-hand sides
+Test(matrix_math, ls_solvefwd_solvebck_multiple_rhs) {
+    unsigned int n = 130, k = 5;
+    matrix *L = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *U = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double l = matrix_at(L, i, j) / n, u = matrix_at(U, i, j) / n;
+            matrix_set(L, i, j, (j < i) ? l : (i == j) ? 2.0 + l : 0.0);
+            matrix_set(U, i, j, (j > i) ? u : (i == j) ? 2.0 + u : 0.0);
+        }
+    }
+    matrix *B = matrix_rand(n, k, -1.0, 1.0, sizeof(double));
+
+    matrix *Y = matrix_ls_solvefwd(L, B);
+    matrix *X = matrix_ls_solvebck(U, B);
+    cr_assert_not_null(Y, "Forward substitution returned NULL");
+    cr_assert_not_null(X, "Back substitution returned NULL");
+
+    matrix *LY = matrix_mult(L, Y);
+    matrix *UX = matrix_mult(U, X);
+    cr_assert(matrix_eq(LY, B, 1e-12), "L * Y does not reproduce B");
+    cr_assert(matrix_eq(UX, B, 1e-12), "U * X does not reproduce B");
+
+    matrix_free(L);
+    matrix_free(U);
+    matrix_free(B);
+    matrix_free(Y);
+    matrix_free(X);
+    matrix_free(LY);
+    matrix_free(UX);
+}
+
+// Test case for float32 GEMM: large enough for the packed kernels and their edge tiles
+Test(matrix_math, float32_mult_matches_double) {
+    matrix *A = matrix_rand(203, 151, -1.0, 1.0, sizeof(double));
+    matrix *B = matrix_rand(151, 177, -1.0, 1.0, sizeof(double));
+    matrix *Af = matrix_convert(A, MATRIX_F32);
+    matrix *Bf = matrix_convert(B, MATRIX_F32);
+
+    matrix *C = matrix_mult(A, B);
+    matrix *Cf = matrix_mult(Af, Bf);
+    cr_assert_not_null(Cf, "Float matrix_mult returned NULL");
+    cr_assert_eq(Cf->dtype, MATRIX_F32, "Float product must be a float matrix");
+    cr_assert(matrix_eq(Cf, C, 1e-3), "Float product differs from the double one");
+
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(Af);
+    matrix_free(Bf);
+    matrix_free(C);
+    matrix_free(Cf);
+}
+
+// Test case for float32 LU and Cholesky, past one block so the blocked paths run
+Test(matrix_math, float32_lu_and_cholesky) {
+    unsigned int n = 300, k = 3;
+    matrix *M = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *Mt = matrix_copy(M);
+    matrix_transpose(Mt);
+    matrix *A = matrix_mult(M, Mt);
+    for (unsigned int i = 0; i < n; i++) {
+        matrix_set(A, i, i, matrix_at(A, i, i) + n);
+    }
+    matrix *Af = matrix_convert(A, MATRIX_F32);
+    matrix *Bf = matrix_rand(n, k, -1.0, 1.0, sizeof(float));
+
+    matrix_lup *lu = matrix_lup_factor(Af, false);
+    cr_assert_not_null(lu, "Float LU factorization failed");
+    matrix *X = matrix_ls_solve(lu, Bf);
+    matrix *AX = matrix_mult(Af, X);
+    cr_assert(matrix_eq(AX, Bf, 1e-4), "Float LU solve does not reproduce B");
+
+    matrix_cholesky *chol = matrix_cholesky_factor(Af, false);
+    cr_assert_not_null(chol, "Float Cholesky factorization failed");
+    matrix *Y = matrix_cholesky_ls_solve(chol, Bf);
+    cr_assert(matrix_eq(Y, X, 1e-5), "Float Cholesky and LU solutions differ");
+
+    matrix *inv = matrix_cholesky_inv(chol, NULL);
+    matrix *prod = matrix_mult(Af, inv);
+    matrix *eye = matrix_sqr(n, sizeof(float));
+    float one = 1.0f;
+    matrix_diag_set(eye, &one, sizeof(one));
+    cr_assert(matrix_eq(prod, eye, 1e-4), "A * inv(A) is not the identity in float");
+
+    matrix_lup_free(lu);
+    matrix_cholesky_factor_free(chol);
+    matrix_free(M);
+    matrix_free(Mt);
+    matrix_free(A);
+    matrix_free(Af);
+    matrix_free(Bf);
+    matrix_free(X);
+    matrix_free(AX);
+    matrix_free(Y);
+    matrix_free(inv);
+    matrix_free(prod);
+    matrix_free(eye);
+}
+
+// Test case for complex GEMM: both 4M and 3M must match a direct complex product
+Test(matrix_math, complex_mult_4m_and_3m) {
+    unsigned int m = 70, k = 45, n = 83;
+    size_t csize = sizeof(double complex);
+    matrix *A = matrix_rand(m, k, -1.0, 1.0, csize);
+    matrix *B = matrix_rand(k, n, -1.0, 1.0, csize);
+    cr_assert_eq(A->dtype, MATRIX_C128, "sizeof(double complex) must give a complex matrix");
+
+    matrix *ref = matrix_new(m, n, csize);
+    for (unsigned int i = 0; i < m; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double complex sum = 0.0;
+            for (unsigned int p = 0; p < k; p++) {
+                sum += *matrix_ptr_c128(A, i, p) * *matrix_ptr_c128(B, p, j);
+            }
+            *matrix_ptr_c128(ref, i, j) = sum;
+        }
+    }
+
+    matrix *C = matrix_mult(A, B);
+    cr_assert(matrix_eq(C, ref, 1e-12), "4M complex product is wrong");
+    matrix_set_complex_gemm(MATRIX_COMPLEX_GEMM_3M);
+    matrix *C3 = matrix_mult(A, B);
+    matrix_set_complex_gemm(MATRIX_COMPLEX_GEMM_4M);
+    cr_assert(matrix_eq(C3, ref, 1e-12), "3M complex product is wrong");
+
+    // Past one KC slab and several row blocks, threaded, with A^H, alpha and beta
+    size_t bm = 150, bk = 600, bn = 90;
+    matrix *BA = matrix_rand(bk, bm, -1.0, 1.0, csize), *BB = matrix_rand(bk, bn, -1.0, 1.0, csize);
+    matrix *BC = matrix_rand(bm, bn, -1.0, 1.0, csize);
+    double alpha = 0.5, beta = 2.0;
+    matrix *bref = matrix_new(bm, bn, csize);
+    for (size_t i = 0; i < bm; i++) {
+        for (size_t j = 0; j < bn; j++) {
+            double complex sum = 0.0;
+            for (size_t p = 0; p < bk; p++) {
+                sum += conj(*matrix_ptr_c128(BA, p, i)) * *matrix_ptr_c128(BB, p, j);
+            }
+            *matrix_ptr_c128(bref, i, j) = alpha * sum + beta * *matrix_ptr_c128(BC, i, j);
+        }
+    }
+    matrix_set_num_threads(4);
+    for (int method = 0; method < 2; method++) {
+        matrix_set_complex_gemm(method ? MATRIX_COMPLEX_GEMM_3M : MATRIX_COMPLEX_GEMM_4M);
+        matrix *out = matrix_copy(BC);
+        cr_assert_not_null(matrix_gemm_op_into(out, alpha, BA, MATRIX_OP_CONJ_TRANS, BB, MATRIX_OP_NONE, beta),
+                           "Complex matrix_gemm_op_into failed");
+        cr_assert(matrix_eq(out, bref, 1e-10), "Blocked complex product is wrong (method %d)", method);
+        matrix_free(out);
+    }
+    matrix_set_complex_gemm(MATRIX_COMPLEX_GEMM_4M);
+    matrix_set_num_threads(0);
+    matrix_free(BA);
+    matrix_free(BB);
+    matrix_free(BC);
+    matrix_free(bref);
+
+    // (A^H)^H = A, and conjugating flips the sign of the imaginary part
+    matrix *AH = matrix_new(k, m, csize);
+    matrix_conj_transpose_into(AH, A);
+    cr_assert(*matrix_ptr_c128(AH, 3, 5) == conj(*matrix_ptr_c128(A, 5, 3)), "Conjugate transpose element is wrong");
+    matrix_conj_transpose(AH);
+    cr_assert(matrix_eq(AH, A, 0.0), "Conjugate transposing twice must give A back");
+
+    matrix *S = matrix_add(A, A);
+    matrix_mult_c(A, 2.0 + 0.0 * I);
+    cr_assert(matrix_eq(S, A, 1e-15), "A + A and 2 * A differ");
+
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(ref);
+    matrix_free(C);
+    matrix_free(C3);
+    matrix_free(AH);
+    matrix_free(S);
+}
+
+// op(x) built the slow way, as an explicit copy
+static matrix *explicit_op(const matrix *x, matrix_op op) {
+    if (op == MATRIX_OP_NONE) {
+        return matrix_copy(x);
+    }
+    matrix *t = matrix_new(x->num_cols, x->num_rows, matrix_element_size(x));
+    return (op == MATRIX_OP_TRANS) ? matrix_transpose_into(t, x) : matrix_conj_transpose_into(t, x);
+}
+
+// Test case for transposed operands against products of explicit transposes
+Test(matrix_math, mult_op_matches_explicit_transpose) {
+    size_t sizes[] = { sizeof(double), sizeof(float), sizeof(double complex) };
+    size_t dims[][3] = { {70, 45, 83}, {5, 3, 4} };  // packed engine, then the small-product loop
+    matrix_op ops[] = { MATRIX_OP_NONE, MATRIX_OP_TRANS, MATRIX_OP_CONJ_TRANS };
+    for (size_t e = 0; e < 3; e++) {
+        double tol = (sizes[e] == sizeof(float)) ? 1e-4 : 1e-12;
+        for (size_t d = 0; d < 2; d++) {
+            size_t m = dims[d][0], k = dims[d][1], n = dims[d][2];
+            for (size_t o1 = 0; o1 < 3; o1++) {
+                for (size_t o2 = 0; o2 < 3; o2++) {
+                    bool t1 = ops[o1] != MATRIX_OP_NONE, t2 = ops[o2] != MATRIX_OP_NONE;
+                    matrix *A = matrix_new_padded(t1 ? k : m, t1 ? m : k, sizes[e]);
+                    matrix *B = matrix_new_padded(t2 ? n : k, t2 ? k : n, sizes[e]);
+                    matrix *RA = matrix_rand(A->num_rows, A->num_cols, -1.0, 1.0, sizes[e]);
+                    matrix *RB = matrix_rand(B->num_rows, B->num_cols, -1.0, 1.0, sizes[e]);
+                    matrix_copy_into(A, RA);
+                    matrix_copy_into(B, RB);
+
+                    matrix *EA = explicit_op(A, ops[o1]), *EB = explicit_op(B, ops[o2]);
+                    matrix *expected = matrix_mult(EA, EB);
+                    matrix *C = matrix_mult_op(A, ops[o1], B, ops[o2]);
+                    cr_assert_not_null(C, "matrix_mult_op failed");
+                    cr_assert(matrix_eq(C, expected, tol), "op(A) * op(B) is wrong for ops %zu, %zu", o1, o2);
+
+                    matrix_free(A);
+                    matrix_free(B);
+                    matrix_free(RA);
+                    matrix_free(RB);
+                    matrix_free(EA);
+                    matrix_free(EB);
+                    matrix_free(expected);
+                    matrix_free(C);
+                }
+            }
+        }
+    }
+
+    // Normal equations: X^T X accumulated with alpha and beta, and a mismatch refused
+    matrix *X = matrix_rand(400, 520, -1.0, 1.0, sizeof(double));
+    matrix *XtX = matrix_mult_op(X, MATRIX_OP_TRANS, X, MATRIX_OP_NONE);
+    matrix *twice = matrix_copy(XtX);
+    cr_assert_eq(matrix_gemm_op_into(twice, 1.0, X, MATRIX_OP_TRANS, X, MATRIX_OP_NONE, 1.0), twice,
+                 "matrix_gemm_op_into must return dst");
+    matrix_mult_r(XtX, 2.0);
+    cr_assert(matrix_eq(twice, XtX, 1e-10), "X^T X + X^T X differs from 2 X^T X");
+    cr_assert_null(matrix_mult_op(X, MATRIX_OP_NONE, X, MATRIX_OP_NONE), "400x520 by 400x520 must be refused");
+
+    // The blocked Cholesky solves its panels from the right, split by rows across threads
+    double shift = 520.0;
+    matrix_mult_r(XtX, 0.5);
+    for (size_t i = 0; i < 520; i++) {
+        matrix_put(XtX, i, i, matrix_get(XtX, i, i) + shift);
+    }
+    matrix_set_num_threads(4);
+    matrix_cholesky *chol = matrix_cholesky_factor(XtX, false);
+    matrix_set_num_threads(0);
+    cr_assert_not_null(chol, "Cholesky of X^T X + 520 I failed");
+    matrix *LLt = matrix_mult_op(chol->L, MATRIX_OP_NONE, chol->L, MATRIX_OP_TRANS);
+    cr_assert(matrix_eq(LLt, XtX, 1e-9), "L * L^T does not reproduce A");
+
+    matrix_cholesky_factor_free(chol);
+    matrix_free(X);
+    matrix_free(XtX);
+    matrix_free(twice);
+    matrix_free(LLt);
+}
+
+// Sets every element of m to v
+static void fill_all(matrix *m, double v) {
+    for (size_t i = 0; i < m->num_rows; i++) {
+        for (size_t j = 0; j < m->num_cols; j++) {
+            matrix_put(m, i, j, v);
+        }
+    }
+}
+
+// Test case for SYRK and SYMM: one triangle computed or read, the other left alone
+Test(matrix_math, syrk_and_symm_touch_one_triangle) {
+    size_t sizes[] = { sizeof(double), sizeof(float) };
+    matrix_op ops[] = { MATRIX_OP_NONE, MATRIX_OP_TRANS };
+    matrix_uplo uplos[] = { MATRIX_LOWER, MATRIX_UPPER };
+    size_t n = 300, k = 70;  // several 128-row blocks and a ragged last one
+    for (size_t e = 0; e < 2; e++) {
+        double tol = (sizes[e] == sizeof(float)) ? 1e-3 : 1e-10;
+        for (size_t o = 0; o < 2; o++) {
+            bool t = ops[o] != MATRIX_OP_NONE;
+            matrix *X = matrix_rand(t ? k : n, t ? n : k, -1.0, 1.0, sizes[e]);
+            matrix *expected = matrix_mult_op(X, ops[o], X, t ? MATRIX_OP_NONE : MATRIX_OP_TRANS);
+            matrix *B = matrix_rand(n, 45, -1.0, 1.0, sizes[e]);
+            for (size_t u = 0; u < 2; u++) {
+                bool lower = uplos[u] == MATRIX_LOWER;
+
+                // 2 * op(X) op(X)^T - dst on one triangle; the other keeps its sentinel
+                matrix *C = matrix_new_padded(n, n, sizes[e]);
+                fill_all(C, 7.0);
+                cr_assert_eq(matrix_syrk_into(C, 2.0, X, ops[o], -1.0, uplos[u], false), C,
+                             "matrix_syrk_into must return dst");
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t j = 0; j < n; j++) {
+                        bool stored = lower ? j <= i : j >= i;
+                        double want = stored ? 2.0 * matrix_get(expected, i, j) - 7.0 : 7.0;
+                        cr_assert(fabs(matrix_get(C, i, j) - want) < tol * 100,
+                                  "SYRK element (%zu, %zu) is wrong for op %zu, uplo %zu", i, j, o, u);
+                    }
+                }
+
+                // Mirrored, the result is the full product
+                cr_assert_not_null(matrix_syrk_into(C, 1.0, X, ops[o], 0.0, uplos[u], true), "SYRK failed");
+                cr_assert(matrix_eq(C, expected, tol), "mirrored SYRK differs from the full product");
+
+                // SYMM must not read the other triangle: poison it with NaN
+                for (size_t i = 0; i < n; i++) {
+                    for (size_t j = 0; j < n; j++) {
+                        if (lower ? j > i : j < i) {
+                            matrix_put(C, i, j, NAN);
+                        }
+                    }
+                }
+                matrix *SB = matrix_mult(expected, B);
+                matrix *D = matrix_symm(C, uplos[u], B);
+                cr_assert_not_null(D, "matrix_symm failed");
+                cr_assert(matrix_eq(D, SB, tol * 100), "S * B is wrong for op %zu, uplo %zu", o, u);
+                matrix_free(D);
+                matrix_free(SB);
+                matrix_free(C);
+            }
+            matrix_free(X);
+            matrix_free(B);
+            matrix_free(expected);
+        }
+    }
+
+    // A lower SYRK feeds the Cholesky factorization directly, unmirrored
+    matrix *X = matrix_rand(600, 260, -1.0, 1.0, sizeof(double));
+    matrix *G = matrix_new(260, 260, sizeof(double));
+    fill_all(G, NAN);
+    matrix_set_num_threads(4);
+    cr_assert_not_null(matrix_syrk_into(G, 1.0, X, MATRIX_OP_TRANS, 0.0, MATRIX_LOWER, false), "SYRK failed");
+    matrix_set_num_threads(0);
+    matrix_cholesky *chol = matrix_cholesky_factor(G, false);
+    cr_assert_not_null(chol, "Cholesky of the lower triangle of X^T X failed");
+    matrix *XtX = matrix_syrk(X, MATRIX_OP_TRANS);
+    cr_assert(matrix_is_symmetric(XtX), "matrix_syrk must mirror its result");
+    matrix *LLt = matrix_mult_op(chol->L, MATRIX_OP_NONE, chol->L, MATRIX_OP_TRANS);
+    cr_assert(matrix_eq(LLt, XtX, 1e-9), "L * L^T does not reproduce X^T X");
+
+    // Complex matrices are refused
+    matrix *Z = matrix_rand(4, 4, -1.0, 1.0, sizeof(double complex));
+    cr_assert_null(matrix_syrk(Z, MATRIX_OP_NONE), "complex SYRK must be refused");
+
+    matrix_cholesky_factor_free(chol);
+    matrix_free(X);
+    matrix_free(G);
+    matrix_free(XtX);
+    matrix_free(LLt);
+    matrix_free(Z);
+}
+
+// Test case for complex LU: solve, inverse and determinant, past one block
+Test(matrix_math, complex_lu_solve_and_inverse) {
+    unsigned int n = 150, k = 4;
+    size_t csize = sizeof(double complex);
+    matrix *A = matrix_rand(n, n, -1.0, 1.0, csize);
+    matrix *B = matrix_rand(n, k, -1.0, 1.0, csize);
+
+    matrix_lup *lu = matrix_lup_factor(A, false);
+    cr_assert_not_null(lu, "Complex LU factorization failed");
+    matrix *X = matrix_ls_solve(lu, B);
+    matrix *AX = matrix_mult(A, X);
+    cr_assert(matrix_eq(AX, B, 1e-9), "Complex LU solve does not reproduce B");
+
+    matrix *inv = matrix_inv(A);
+    cr_assert_not_null(inv, "Complex inverse returned NULL");
+    matrix *prod = matrix_mult(A, inv);
+    matrix *eye = matrix_sqr(n, csize);
+    double complex one = 1.0;
+    matrix_diag_set(eye, &one, sizeof(one));
+    cr_assert(matrix_eq(prod, eye, 1e-9), "A * inv(A) is not the identity");
+
+    // det(2x2) = ad - bc
+    matrix *M = matrix_sqr(2, csize);
+    *matrix_ptr_c128(M, 0, 0) = 1.0 + 2.0 * I;
+    *matrix_ptr_c128(M, 0, 1) = 3.0;
+    *matrix_ptr_c128(M, 1, 0) = -1.0 * I;
+    *matrix_ptr_c128(M, 1, 1) = 2.0 - 1.0 * I;
+    matrix_lup *mlu = matrix_lup_factor(M, false);
+    double complex det = matrix_det_c(mlu);
+    double complex expected = (1.0 + 2.0 * I) * (2.0 - 1.0 * I) - 3.0 * (-1.0 * I);
+    cr_assert(cabs(det - expected) < 1e-12, "Complex determinant is wrong");
+
+    matrix_lup_free(lu);
+    matrix_lup_free(mlu);
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(X);
+    matrix_free(AX);
+    matrix_free(inv);
+    matrix_free(prod);
+    matrix_free(eye);
+    matrix_free(M);
+}
+
+// Test case for the ISA override: every kernel variant the CPU runs must agree with the portable one
+Test(matrix_math, isa_variants_agree) {
+    matrix *A = matrix_rand(131, 77, -1.0, 1.0, sizeof(double));
+    matrix *B = matrix_rand(77, 93, -1.0, 1.0, sizeof(double));
+    matrix *S = matrix_rand(150, 150, -1.0, 1.0, sizeof(double));
+    matrix *Af = matrix_convert(A, MATRIX_F32);
+    matrix *Bf = matrix_convert(B, MATRIX_F32);
+    for (size_t i = 0; i < S->num_rows; i++) {
+        matrix_put(S, i, i, matrix_get(S, i, i) + 150.0);
+    }
+
+    matrix_isa isa = matrix_set_isa(MATRIX_ISA_SCALAR);
+    cr_assert_eq(isa, MATRIX_ISA_SCALAR, "The portable kernels must always be available");
+    cr_assert(strcmp(matrix_isa_name(isa), "scalar") == 0, "Wrong name for the portable level");
+    matrix *prod = matrix_mult(A, B);
+    matrix *prod_f = matrix_mult(Af, Bf);
+    matrix *sum = matrix_add(A, A);
+    matrix *inv = matrix_inv(S);
+    matrix *trans = matrix_transpose_into(matrix_new(77, 131, sizeof(double)), A);
+
+    for (int level = MATRIX_ISA_SSE42; level <= MATRIX_ISA_AVX512; level++) {
+        isa = matrix_set_isa((matrix_isa)level);
+        cr_assert_leq(isa, level, "matrix_set_isa went above the requested level");
+        cr_assert_eq(matrix_get_isa(), isa, "matrix_get_isa disagrees with matrix_set_isa");
+        cr_assert(strcmp(matrix_isa_name(isa), "unknown") != 0, "Level %d has no name", (int)isa);
+
+        matrix *p = matrix_mult(A, B);
+        matrix *pf = matrix_mult(Af, Bf);
+        matrix *s = matrix_subtract(A, A);
+        matrix_mult_r(s, 3.0);
+        matrix *v = matrix_inv(S);
+        matrix *t = matrix_transpose_into(matrix_new(77, 131, sizeof(double)), A);
+        double two = 2.0;
+        matrix *f = matrix_new(5, 13, sizeof(double));
+        matrix_all_set(f, &two, sizeof(two));
+
+        cr_assert(matrix_eq(p, prod, 1e-12), "%s GEMM differs", matrix_isa_name(isa));
+        cr_assert(matrix_eq(pf, prod_f, 1e-4), "%s float GEMM differs", matrix_isa_name(isa));
+        matrix_add_into(s, s, A);
+        matrix_add_into(s, s, A);
+        cr_assert(matrix_eq(s, sum, 1e-15), "%s add/subtract/scale differs", matrix_isa_name(isa));
+        cr_assert(matrix_eq(v, inv, 1e-12), "%s LU inverse differs", matrix_isa_name(isa));
+        cr_assert(matrix_eq(t, trans, 0.0), "%s transpose differs", matrix_isa_name(isa));
+        cr_assert_eq(matrix_get(f, 4, 12), 2.0, "%s fill missed the last element", matrix_isa_name(isa));
+
+        matrix_free(p);
+        matrix_free(pf);
+        matrix_free(s);
+        matrix_free(v);
+        matrix_free(t);
+        matrix_free(f);
+    }
+    matrix_set_isa(MATRIX_ISA_AVX512);
+
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(S);
+    matrix_free(Af);
+    matrix_free(Bf);
+    matrix_free(prod);
+    matrix_free(prod_f);
+    matrix_free(sum);
+    matrix_free(inv);
+    matrix_free(trans);
+}
+
+// Test case for fused expressions against the same arithmetic done one call at a time
+Test(matrix_math, expression_fused_matches_unfused) {
+    size_t n = 1030;  // split across threads, and large enough for streamed output
+    matrix *A = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *B = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *C = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+
+    // (A + B) * 2.5 - C, with the scalar folded from 0.5 * 5
+    matrix *expected = matrix_add(A, B);
+    matrix_mult_r(expected, 2.5);
+    matrix_subtract_into(expected, expected, C);
+
+    matrix_expr *e = matrix_expr_new();
+    int a = matrix_expr_matrix(e, A), b = matrix_expr_matrix(e, B), c = matrix_expr_matrix(e, C);
+    int s = matrix_expr_mul(e, matrix_expr_scalar(e, 0.5), matrix_expr_scalar(e, 5.0));
+    int root = matrix_expr_sub(e, matrix_expr_mul(e, matrix_expr_add(e, a, b), s), c);
+    matrix_set_num_threads(4);
+    matrix *result = matrix_expr_eval(e, root, NULL);
+    matrix_set_num_threads(0);
+    cr_assert_not_null(result, "Evaluating into a new matrix failed");
+    cr_assert(matrix_eq(result, expected, 1e-14), "Fused result differs from the unfused one");
+
+    // A node used twice, division and negation, evaluated into one of the operands
+    matrix_expr_clear(e);
+    a = matrix_expr_matrix(e, A);
+    b = matrix_expr_matrix(e, B);
+    int sq = matrix_expr_mul(e, a, a);
+    root = matrix_expr_neg(e, matrix_expr_div(e, sq, matrix_expr_add(e, b, matrix_expr_scalar(e, 3.0))));
+    matrix *B_copy = matrix_copy(B);
+    cr_assert_eq(matrix_expr_eval(e, root, B), B, "Evaluating into an operand must return it");
+    for (size_t i = 0; i < n; i += 99) {
+        double x = matrix_get(A, i, n - 1 - i), y = matrix_get(B_copy, i, n - 1 - i);
+        cr_assert(fabs(matrix_get(B, i, n - 1 - i) + x * x / (y + 3.0)) < 1e-14, "-(A*A)/(B+3) is wrong");
+    }
+
+    // Padded float operands take the row-by-row path
+    matrix *F = matrix_new_padded(5, 7, sizeof(float));
+    matrix *G = matrix_new_padded(5, 7, sizeof(float));
+    float one = 1.0f, two = 2.0f;
+    matrix_all_set(F, &one, sizeof(one));
+    matrix_all_set(G, &two, sizeof(two));
+    matrix_expr_clear(e);
+    root = matrix_expr_sub(e, matrix_expr_matrix(e, F), matrix_expr_mul(e, matrix_expr_matrix(e, G), matrix_expr_matrix(e, G)));
+    matrix *H = matrix_expr_eval(e, root, NULL);
+    cr_assert_not_null(H, "Float expression failed");
+    cr_assert_eq(H->dtype, MATRIX_F32, "Result must keep the operands' type");
+    cr_assert_eq(matrix_get(H, 4, 6), -3.0, "1 - 2 * 2 should be -3");
+
+    // Errors: mismatched shapes, invalid nodes, a scalar-only expression without dst
+    matrix_expr_clear(e);
+    root = matrix_expr_add(e, matrix_expr_matrix(e, A), matrix_expr_matrix(e, F));
+    cr_assert_null(matrix_expr_eval(e, root, NULL), "Mismatched operands must be refused");
+    cr_assert_eq(matrix_expr_add(e, -1, 0), -1, "An invalid operand must give an invalid node");
+    cr_assert_null(matrix_expr_eval(e, -1, NULL), "An invalid root must be refused");
+    cr_assert_null(matrix_expr_eval(e, matrix_expr_scalar(e, 1.0), NULL), "A scalar expression needs a dst");
+
+    matrix_expr_free(e);
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(C);
+    matrix_free(B_copy);
+    matrix_free(expected);
+    matrix_free(result);
+    matrix_free(F);
+    matrix_free(G);
+    matrix_free(H);
+}
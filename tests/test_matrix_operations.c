@@ -2,6 +2,7 @@
 #include <criterion/logging.h>
 #include <criterion/redirect.h>
 #include <stdio.h>
+#include <math.h>
 #include "../include/matrix.h"  // Replace with your actual matrix library header
 
 Test(matrix_operations, valid_index) {
@@ -442,6 +443,57 @@ Test(matrix_operations, inverse_2x2_matrix) {
     matrix_free(inv_check);
 }
 
+// Test case for the blocked inverse: several panels, pivoting and a non-multiple of the block size
+Test(matrix_operations, inverse_blocked_matrix) {
+    unsigned int n = 301;
+    matrix *mat = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    double identity_element = 1.0;
+    matrix *identity = matrix_eye(n, sizeof(double), &identity_element);
+
+    matrix *inverse = matrix_inv(mat);
+    cr_assert_not_null(inverse, "Matrix inversion returned NULL");
+
+    matrix *product = matrix_mult(mat, inverse);
+    cr_assert(matrix_eq(product, identity, 1e-8), "A * inv(A) is not the identity");
+
+    matrix_free(mat);
+    matrix_free(identity);
+    matrix_free(inverse);
+    matrix_free(product);
+}
+
+// Test case for inverting into a caller-supplied matrix, in place and from an existing factorization
+Test(matrix_operations, inverse_into_and_from_lup) {
+    matrix *mat = matrix_new(3, 3, sizeof(double));
+    double values[9] = {0.0, 2.0, 1.0, 1.0, 1.0, 0.0, 3.0, 0.0, 1.0};
+    memcpy(mat->data, values, 9 * sizeof(double));
+
+    matrix *expected = matrix_inv(mat);
+    cr_assert_not_null(expected, "Matrix inversion returned NULL");
+
+    matrix *dst = matrix_new(3, 3, sizeof(double));
+    cr_assert_eq(matrix_inv_into(dst, mat), dst, "matrix_inv_into must return the output matrix");
+    cr_assert(matrix_eq(dst, expected, 1e-12), "Inverse written into dst is incorrect");
+
+    matrix_lup *lu = matrix_lup_factor(mat, false);
+    matrix *from_lup = matrix_lup_inv(lu, NULL);
+    cr_assert_not_null(from_lup, "Inversion from the LUP decomposition returned NULL");
+    cr_assert(matrix_eq(from_lup, expected, 1e-12), "Inverse from the LUP decomposition is incorrect");
+
+    cr_assert_eq(matrix_inv_into(mat, mat), mat, "In-place inversion must return the matrix");
+    cr_assert(matrix_eq(mat, expected, 1e-12), "In-place inverse is incorrect");
+
+    matrix *wrong = matrix_new(2, 2, sizeof(double));
+    cr_assert_null(matrix_inv_into(wrong, mat), "Mismatched output dimensions must be rejected");
+
+    matrix_lup_free(lu);
+    matrix_free(mat);
+    matrix_free(expected);
+    matrix_free(dst);
+    matrix_free(from_lup);
+    matrix_free(wrong);
+}
+
 Test(matrix_operations, trace_2x2_matrix) {
     unsigned int rows = 2, cols = 2;
     matrix *mat = matrix_new(rows, cols, sizeof(double));
@@ -520,3 +572,234 @@ Test(matrix_operations, cholesky_decomposition) {
     matrix_free(mat);
 }
 
+// Builds a random n x n symmetric positive-definite matrix M * M^T + n * I
+static matrix *spd_matrix(unsigned int n) {
+    matrix *M = matrix_rand(n, n, -1.0, 1.0, sizeof(double));
+    matrix *Mt = matrix_copy(M);
+    matrix_transpose(Mt);
+    matrix *A = matrix_mult(M, Mt);
+    for (unsigned int i = 0; i < n; i++) {
+        ((double *)A->data)[i * n + i] += n;
+    }
+    matrix_free(M);
+    matrix_free(Mt);
+    return A;
+}
+
+// Test case for the blocked Cholesky factorization: L * L^T must reproduce A
+Test(matrix_operations, cholesky_factor_blocked) {
+    unsigned int n = 300;
+    matrix *A = spd_matrix(n);
+
+    matrix_cholesky *chol = matrix_cholesky_factor(A, false);
+    cr_assert_not_null(chol, "Cholesky factorization failed for an SPD matrix");
+    cr_assert(chol->owns_L, "Out-of-place factor must be owned by the decomposition");
+
+    matrix *L = chol->L;
+    for (unsigned int i = 0; i < n; i++) {
+        cr_assert_gt(matrix_at(L, i, i), 0.0, "Diagonal of L must be positive");
+        for (unsigned int j = i + 1; j < n; j++) {
+            cr_assert_eq(matrix_at(L, i, j), 0.0, "Non-zero element in the upper triangle of L");
+        }
+    }
+
+    matrix *Lt = matrix_copy(L);
+    matrix_transpose(Lt);
+    matrix *LLt = matrix_mult(L, Lt);
+    cr_assert(matrix_eq(LLt, A, 1e-9), "L * L^T does not reproduce A");
+
+    matrix_cholesky_factor_free(chol);
+    matrix_free(A);
+    matrix_free(Lt);
+    matrix_free(LLt);
+}
+
+// Test case for in-place Cholesky: the lower triangle is overwritten, the upper one untouched
+Test(matrix_operations, cholesky_factor_in_place) {
+    unsigned int n = 200;
+    matrix *A = spd_matrix(n);
+    matrix_cholesky *reference = matrix_cholesky_factor(A, false);
+    matrix *expected = reference->L;
+    matrix *original = matrix_copy(A);
+
+    matrix_cholesky *chol = matrix_cholesky_factor(A, true);
+    cr_assert_not_null(chol, "In-place Cholesky factorization failed");
+    cr_assert_eq(chol->L, A, "In-place factorization must use the input matrix");
+    cr_assert(!chol->owns_L, "In-place factor must not be owned by the decomposition");
+
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < n; j++) {
+            double want = (j <= i) ? matrix_at(expected, i, j) : matrix_at(original, i, j);
+            cr_assert_float_eq(matrix_at(A, i, j), want, 1e-12, "Element at [%u][%u] is incorrect", i, j);
+        }
+    }
+
+    matrix_cholesky_factor_free(chol);
+    matrix_cholesky_factor_free(reference);
+    matrix_free(A);
+    matrix_free(original);
+}
+
+// Test case for Cholesky on an indefinite matrix: it must fail instead of producing NaNs
+Test(matrix_operations, cholesky_factor_not_posdef) {
+    unsigned int n = 150;
+    matrix *A = spd_matrix(n);
+    ((double *)A->data)[140 * n + 140] = -1.0;
+
+    cr_assert_null(matrix_cholesky_factor(A, false), "Indefinite matrix must be rejected");
+
+    matrix *B = matrix_new(2, 2, sizeof(double));
+    double values[4] = {1.0, 2.0, 2.0, 1.0};
+    memcpy(B->data, values, 4 * sizeof(double));
+    cr_assert_null(matrix_cholesky_solve(B), "Indefinite matrix must be rejected");
+
+    matrix_free(A);
+    matrix_free(B);
+}
+
+// Test case for solving several right-hand sides from one Cholesky factorization
+Test(matrix_operations, cholesky_ls_solve_multiple_rhs) {
+    unsigned int n = 250, k = 7;
+    matrix *A = spd_matrix(n);
+    matrix *B = matrix_rand(n, k, -1.0, 1.0, sizeof(double));
+
+    matrix_cholesky *chol = matrix_cholesky_factor(A, false);
+    cr_assert_not_null(chol, "Cholesky factorization failed for an SPD matrix");
+
+    matrix *X = matrix_cholesky_ls_solve(chol, B);
+    cr_assert_not_null(X, "Solution is NULL");
+    cr_assert_eq(X->num_cols, k, "Solution has incorrect number of columns");
+
+    matrix *AX = matrix_mult(A, X);
+    cr_assert(matrix_eq(AX, B, 1e-9), "A * X does not reproduce B");
+
+    matrix_cholesky_factor_free(chol);
+    matrix_free(A);
+    matrix_free(B);
+    matrix_free(X);
+    matrix_free(AX);
+}
+
+// Test case for the SPD inverse and log-determinant, checked against the LU results
+Test(matrix_operations, cholesky_inverse_and_logdet) {
+    unsigned int n = 270;
+    matrix *A = spd_matrix(n);
+    matrix *expected = matrix_inv(A);
+
+    matrix_cholesky *chol = matrix_cholesky_factor(A, false);
+    cr_assert_not_null(chol, "Cholesky factorization failed for an SPD matrix");
+
+    matrix *inverse = matrix_cholesky_inv(chol, NULL);
+    cr_assert_not_null(inverse, "Cholesky inversion returned NULL");
+    cr_assert(matrix_eq(inverse, expected, 1e-12), "Cholesky inverse differs from the LU inverse");
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < i; j++) {
+            cr_assert_eq(matrix_at(inverse, i, j), matrix_at(inverse, j, i), "Inverse is not symmetric");
+        }
+    }
+
+    matrix_lup *lu = matrix_lup_factor(A, false);
+    double logdet = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+        logdet += log(fabs(matrix_at(lu->LU, i, i)));
+    }
+    cr_assert_float_eq(matrix_cholesky_logdet(chol), logdet, 1e-9, "Log-determinant is incorrect");
+
+    // Inverting into the factor itself must work too
+    cr_assert_eq(matrix_cholesky_inv(chol, chol->L), chol->L, "In-place inversion must return the factor");
+    cr_assert(matrix_eq(chol->L, expected, 1e-12), "In-place Cholesky inverse is incorrect");
+
+    matrix_lup_free(lu);
+    matrix_cholesky_factor_free(chol);
+    matrix_free(A);
+    matrix_free(expected);
+    matrix_free(inverse);
+}
+
+// Test case for views: they alias the parent, read like matrices and copy out packed
+Test(matrix_operations, views_alias_parent) {
+    unsigned int rows = 6, cols = 9;
+    matrix *mat = matrix_rand(rows, cols, -1.0, 1.0, sizeof(double));
+
+    Range row_range = {1, 5};
+    Range col_range = {2, 5};
+    matrix view = matrix_view(mat, row_range, col_range);
+    cr_assert_not_null(view.data, "matrix_view returned an empty view for a valid range");
+    cr_assert_eq(view.num_rows, 4, "View should have 4 rows");
+    cr_assert_eq(view.num_cols, 3, "View should have 3 columns");
+    cr_assert_eq(view.stride, mat->stride, "View must keep the parent's stride");
+    cr_assert_not(view.owns_data, "A view must not own its data");
+    cr_assert_eq(matrix_get(&view, 2, 1), matrix_at(mat, 3, 3), "View element differs from parent");
+
+    // Writes go through to the parent
+    matrix_set(&view, 0, 0, 42.0);
+    cr_assert_eq(matrix_at(mat, 1, 2), 42.0, "Write through a view did not reach the parent");
+
+    // Read-only operations accept views, and copies of views are packed
+    matrix *sub = matrix_submatrix(mat, row_range, col_range);
+    cr_assert(matrix_eq(&view, sub, 0.0), "View and submatrix differ");
+    cr_assert(sub->owns_data, "A submatrix must own its data");
+    matrix *copy = matrix_copy(&view);
+    cr_assert_eq(copy->stride, copy->num_cols, "Copy of a view should be packed");
+    matrix *product = matrix_mult(&view, &view);
+    cr_assert_null(product, "Multiplying a 4x3 view by itself should fail");
+
+    // Row and column views, and the copying getters built on them
+    matrix row = matrix_row_view(mat, 4);
+    matrix col = matrix_col_view(mat, 7);
+    cr_assert_eq(row.num_rows, 1, "Row view should have 1 row");
+    cr_assert_eq(col.num_cols, 1, "Column view should have 1 column");
+    matrix *row_copy = matrix_row_get(mat, 4);
+    matrix *col_copy = matrix_col_get(mat, 7);
+    cr_assert(matrix_eq(&row, row_copy, 0.0), "matrix_row_get differs from the row view");
+    cr_assert(matrix_eq(&col, col_copy, 0.0), "matrix_col_get differs from the column view");
+    matrix *rc = matrix_mult(&col, &row);
+    cr_assert_not_null(rc, "Multiplying a column view by a row view failed");
+    cr_assert_float_eq(matrix_at(rc, 2, 5), matrix_at(mat, 2, 7) * matrix_at(mat, 4, 5), 1e-15,
+                       "Outer product of views is incorrect");
+
+    // Invalid ranges give empty views and no copies
+    Range bad = {3, 3};
+    cr_assert_null(matrix_view(mat, bad, col_range).data, "Empty range should give an empty view");
+    cr_assert_null(matrix_col_view(mat, cols).data, "Out-of-range column should give an empty view");
+    cr_assert_null(matrix_row_get(mat, rows), "Out-of-range row should give NULL");
+
+    matrix_free(mat);
+    matrix_free(sub);
+    matrix_free(copy);
+    matrix_free(row_copy);
+    matrix_free(col_copy);
+    matrix_free(rc);
+}
+
+// Test case for solving in place through a view of a larger, padded matrix
+Test(matrix_operations, view_lup_solve_in_place) {
+    unsigned int n = 150;
+    matrix *big = matrix_new_padded(n + 10, n + 20, sizeof(double));
+    for (unsigned int i = 0; i < big->num_rows; i++) {
+        for (unsigned int j = 0; j < big->num_cols; j++) {
+            matrix_put(big, i, j, (i == j + 5) ? 2.0 * n : sin(i * 0.37 + j * 1.3));
+        }
+    }
+
+    Range row_range = {5, n + 5};
+    Range col_range = {0, n};
+    matrix view = matrix_view(big, row_range, col_range);
+    matrix *A = matrix_copy(&view);
+    matrix *b = matrix_rand(n, 3, -1.0, 1.0, sizeof(double));
+
+    matrix_lup *lu = matrix_lup_factor(&view, true);
+    cr_assert_not_null(lu, "In-place LU of a view failed");
+    matrix *x = matrix_ls_solve(lu, b);
+    matrix *Ax = matrix_mult(A, x);
+    cr_assert(matrix_eq(Ax, b, 1e-10), "Solve through a view is incorrect");
+    cr_assert_eq(matrix_at(big, 0, 0), sin(1.3 * 0), "Rows outside the view were modified");
+    cr_assert_eq(matrix_at(big, 5, n), sin(5 * 0.37 + n * 1.3), "Columns outside the view were modified");
+
+    matrix_lup_free(lu);
+    matrix_free(big);
+    matrix_free(A);
+    matrix_free(b);
+    matrix_free(x);
+    matrix_free(Ax);
+}